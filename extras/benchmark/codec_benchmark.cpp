@@ -0,0 +1,202 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+// Throughput and latency benchmark of the SerialCAN codec on the host.
+// Frames are sent and received through an in-memory loopback stream for every DLC and
+// CRC setting, one frame per send() and as super-packets with sendPacket(). Prints CSV by
+// default, or JSON with --json.
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+// Super-packets are as large as the transmit batch buffer
+#define SERIALCAN_TX_BATCH_BUFFER_SIZE 512
+
+#include "SerialCAN.h"
+
+using serial_can::BasicSerialCAN;
+using serial_can::Frame;
+using serial_can::SerialCANBase;
+
+namespace {
+
+/**
+ * In-memory stream where everything written can be read back.
+ */
+class LoopbackStream {
+ public:
+    static const size_t buffer_size = 1 << 16;
+
+    void begin(uint32_t baud_rate) { static_cast<void>(baud_rate); }
+    int available() { return static_cast<int>(_write_idx - _read_idx); }
+    int read() { return _read_idx < _write_idx ? _buffer[_read_idx++ & (buffer_size - 1)] : -1; }
+    size_t written() const { return _write_idx; }
+    size_t write(uint8_t val) { return write(&val, 1); }
+    size_t write(const uint8_t *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            _buffer[_write_idx++ & (buffer_size - 1)] = data[i];
+        }
+        return size;
+    }
+
+ private:
+    uint8_t _buffer[buffer_size];
+    size_t _write_idx = 0;
+    size_t _read_idx = 0;
+};
+
+struct Result {
+    const char *framing;
+    const char *crc;
+    size_t dlc;
+    size_t payload_bytes;
+    double wire_bytes;
+    double encode_ns;
+    double send_ns;
+    double receive_ns;
+    uint32_t errors;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t batch_frames = 256;
+const size_t total_frames = 2000000;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+Result run(Frame::crc_settings use_crc, uint8_t dlc, bool packets) {
+    static LoopbackStream loopback;
+    static Frame outgoing_frames[batch_frames];
+    static uint8_t packet_buffer[SERIALCAN_TX_BATCH_BUFFER_SIZE];
+    BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+    Frame outgoing_frame{0x123, dlc, use_crc};
+    Frame incoming_frame{use_crc};
+    const char *text = "abcdefgh";
+    char payload[9] = {};
+
+    // E2E protection takes the last two payload bytes
+    size_t payload_bytes = use_crc == Frame::crc8 ? dlc - 2 : dlc;
+    memcpy(payload, text, payload_bytes);
+
+    Result result = {packets ? "packet" : "frame", use_crc == Frame::crc8 ? "crc8" : "no_crc",
+        dlc, payload_bytes, 0, 0, 0, 0, 0};
+    size_t written = loopback.written();
+    serialCAN.begin(0);
+    serialCAN.enablePackets(packet_buffer, sizeof(packet_buffer));
+
+    for (size_t i = 0; i < batch_frames; i++) {
+        outgoing_frames[i] = outgoing_frame;
+        outgoing_frames[i].timestamp = i;
+    }
+
+    for (size_t sent = 0; sent < total_frames; sent += batch_frames) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < batch_frames; i++) {
+            outgoing_frame.encode(payload);
+        }
+        result.encode_ns += elapsedNs(start);
+
+        start = Clock::now();
+        if (packets) {
+            serialCAN.sendPacket(outgoing_frames, batch_frames);
+        } else {
+            for (size_t i = 0; i < batch_frames; i++) {
+                serialCAN.send(&outgoing_frame, i);
+            }
+        }
+        result.send_ns += elapsedNs(start);
+
+        start = Clock::now();
+        for (size_t i = 0; i < batch_frames; i++) {
+            if (serialCAN.tryReceive(&incoming_frame) != SerialCANBase::frame_ready) {
+                result.errors++;
+            }
+        }
+        result.receive_ns += elapsedNs(start);
+    }
+
+    result.wire_bytes = static_cast<double>(loopback.written() - written) / total_frames;
+    result.encode_ns /= total_frames;
+    result.send_ns /= total_frames;
+    result.receive_ns /= total_frames;
+    return result;
+}
+
+void print(const Result &result, bool json, bool last) {
+    double frames_per_sec = 1e9 / (result.send_ns + result.receive_ns);
+    if (json) {
+        printf("  {\"framing\": \"%s\", \"crc\": \"%s\", \"dlc\": %zu, \"payload_bytes\": %zu, "
+            "\"wire_bytes\": %.2f, \"overhead_bytes\": %.2f, \"encode_ns_per_frame\": %.2f, "
+            "\"send_ns_per_frame\": %.2f, \"receive_ns_per_frame\": %.2f, "
+            "\"frames_per_sec\": %.0f, \"errors\": %u}%s\n",
+            result.framing, result.crc, result.dlc, result.payload_bytes, result.wire_bytes,
+            result.wire_bytes - result.payload_bytes, result.encode_ns, result.send_ns,
+            result.receive_ns, frames_per_sec, result.errors, last ? "" : ",");
+    } else {
+        printf("%s,%s,%zu,%zu,%.2f,%.2f,%.2f,%.2f,%.2f,%.0f,%u\n",
+            result.framing, result.crc, result.dlc, result.payload_bytes, result.wire_bytes,
+            result.wire_bytes - result.payload_bytes, result.encode_ns, result.send_ns,
+            result.receive_ns, frames_per_sec, result.errors);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    bool json = argc > 1 && strcmp(argv[1], "--json") == 0;
+    uint32_t errors = 0;
+
+    if (json) {
+        printf("[\n");
+    } else {
+        printf("framing,crc,dlc,payload_bytes,wire_bytes,overhead_bytes,encode_ns_per_frame,"
+            "send_ns_per_frame,receive_ns_per_frame,frames_per_sec,errors\n");
+    }
+
+    for (int packets = 0; packets <= 1; packets++) {
+        for (uint8_t dlc = 0; dlc <= serial_can::MAX_DLC; dlc++) {
+            Result result = run(Frame::no_crc, dlc, packets);
+            errors += result.errors;
+            print(result, json, false);
+        }
+
+        // CRC8 needs room for the counter and CRC bytes
+        for (uint8_t dlc = 2; dlc <= serial_can::MAX_DLC; dlc++) {
+            Result result = run(Frame::crc8, dlc, packets);
+            errors += result.errors;
+            print(result, json, packets && dlc == serial_can::MAX_DLC);
+        }
+    }
+
+    if (json) {
+        printf("]\n");
+    }
+
+    return errors == 0 ? 0 : 1;
+}
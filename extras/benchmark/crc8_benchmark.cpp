@@ -0,0 +1,100 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+// Microbenchmark of the CRC8 engines in CRC8.hpp on the host.
+// Prints one CSV line per engine and message length:
+//   engine,bytes,ns_per_message,ns_per_byte,crc
+
+#include <stdio.h>
+#include <chrono>
+
+#include "CRC8.hpp"
+
+namespace {
+
+typedef uint8_t (*Crc8Function)(uint8_t const message[], size_t nBytes);
+
+struct Engine {
+    const char *name;
+    Crc8Function function;
+};
+
+const Engine engines[] = {
+    {"table", serial_can::crc8Table},
+    {"progmem", serial_can::crc8Progmem},
+    {"nibble", serial_can::crc8Nibble},
+    {"slice4", serial_can::crc8Slice4},
+};
+
+// Payload sizes covered by CRC8 in classic and FD frames (DLC minus the CRC byte)
+const size_t message_lengths[] = {1, 3, 5, 7, 11, 15, 23, 31, 47, 63};
+
+const size_t iterations = 2000000;
+
+volatile uint8_t sink;
+
+}  // namespace
+
+int main() {
+    uint8_t message[64];
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+
+    printf("engine,bytes,ns_per_message,ns_per_byte,crc\n");
+
+    int mismatches = 0;
+    for (size_t length : message_lengths) {
+        uint8_t expected = serial_can::crc8Table(message, length);
+
+        for (const Engine &engine : engines) {
+            uint8_t crc = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                // Feed the previous result back in so iterations cannot be folded
+                message[0] = crc;
+                crc = engine.function(message, length);
+            }
+            auto stop = std::chrono::steady_clock::now();
+            sink = crc;
+
+            message[0] = 11;
+            if (engine.function(message, length) != expected) {
+                mismatches++;
+            }
+
+            double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+            printf("%s,%zu,%.2f,%.3f,0x%02x\n", engine.name, length,
+                ns / iterations, ns / iterations / length, expected);
+        }
+    }
+
+    if (mismatches > 0) {
+        fprintf(stderr, "%d CRC8 engine mismatches\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
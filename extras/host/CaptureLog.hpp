@@ -0,0 +1,424 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_EXTRAS_HOST_CAPTURELOG_HPP_
+#define SERIALCAN_EXTRAS_HOST_CAPTURELOG_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+#include "SerialCAN.h"
+
+namespace serial_can {
+
+/**
+ * Header at the start of a capture file. All fields are in host byte order.
+ */
+struct CaptureHeader {
+    char magic[8];              /**< CAPTURE_MAGIC. */
+    uint16_t version;           /**< CAPTURE_VERSION. */
+    uint16_t record_size;       /**< Size of each record in bytes. */
+    uint32_t max_dlc;           /**< Payload capacity of each record. */
+};
+
+static const char CAPTURE_MAGIC[8] = {'S', 'C', 'A', 'N', 'C', 'A', 'P', '\0'};
+static const uint16_t CAPTURE_VERSION = 1;
+
+/**
+ * Fixed-size capture record of a received frame, or of a receive fault.
+ * @tparam MaxDLC The payload capacity, MAX_DLC or MAX_FD_DLC.
+ */
+template<size_t MaxDLC>
+struct BasicCaptureRecord {
+    uint64_t receive_us;        /**< Host time the frame was received, in microseconds. */
+    uint32_t timestamp;         /**< Timestamp of the frame. */
+    uint32_t arbitration_id;    /**< Arbitration ID of the frame. */
+    uint8_t dlc;                /**< Payload length in bytes. */
+    uint8_t flags;              /**< Frame flags, see FrameBase::frame_flags. */
+    uint8_t use_crc;            /**< CRC setting the frame was received with. */
+    uint8_t counter;            /**< Counter of a CRC protected frame. */
+    uint8_t crc;                /**< CRC of a CRC protected frame. */
+    uint8_t fault_reason;       /**< SerialCANBase::fault_reason, none for a valid frame. */
+    uint8_t reserved[2];        /**< Zero. */
+    uint8_t payload[MaxDLC];    /**< The payload as received, including counter and CRC. */
+
+    /**
+     * Copies the record into a frame.
+     * @param frame The frame to populate.
+     * @return True if the frame was populated, false if the record is corrupt, i.e. its
+     *         DLC is larger than MaxDLC. The frame is left untouched in that case.
+     */
+    bool toFrame(BasicFrame<MaxDLC> *frame) const {
+        if (dlc > MaxDLC) {
+            return false;
+        }
+
+        frame->arbitration_id = arbitration_id;
+        frame->timestamp = timestamp;
+        frame->dlc = dlc;
+        frame->flags = flags;
+        frame->use_crc = static_cast<FrameBase::crc_settings>(use_crc);
+        frame->counter = counter;
+        frame->crc = crc;
+        memcpy(frame->payload, payload, dlc);
+        return true;
+    }
+};
+
+/**
+ * Capture record of a classic CAN frame, 32 bytes.
+ */
+typedef BasicCaptureRecord<MAX_DLC> CaptureRecord;
+static_assert(sizeof(CaptureRecord) == 32, "Unexpected capture record padding");
+
+/**
+ * Appends received frames to a capture file. Records are collected in a buffer and
+ * written in large chunks, so that capturing at full line rate costs few system calls.
+ * @tparam MaxDLC The payload capacity, MAX_DLC or MAX_FD_DLC.
+ */
+template<size_t MaxDLC = MAX_DLC>
+class CaptureWriter {
+ public:
+    typedef BasicCaptureRecord<MaxDLC> Record;
+    static const size_t chunk_size = 1 << 16;  /**< Size of the write buffer in bytes. */
+
+    CaptureWriter() = default;
+    ~CaptureWriter() { close(); }
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    /**
+     * Creates a capture file, replacing an existing one, and writes the header.
+     * @param path Path to the capture file.
+     * @return True if the file was created.
+     */
+    bool open(const char *path) {
+        close();
+        _fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (_fd < 0) {
+            return false;
+        }
+
+        CaptureHeader header = {};
+        memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = CAPTURE_VERSION;
+        header.record_size = sizeof(Record);
+        header.max_dlc = MaxDLC;
+        return writeAll_(&header, sizeof(header));
+    }
+
+    /**
+     * Appends a received frame.
+     * @param frame The received frame.
+     * @param receive_us Host time the frame was received, in microseconds.
+     * @return False if a write failed.
+     */
+    bool write(const BasicFrame<MaxDLC> &frame, uint64_t receive_us) {
+        Record &record = nextRecord_(receive_us, SerialCANBase::none);
+        record.timestamp = frame.timestamp;
+        record.arbitration_id = frame.arbitration_id;
+        record.dlc = frame.dlc;
+        record.flags = frame.flags;
+        record.use_crc = frame.use_crc;
+        record.counter = frame.counter;
+        record.crc = frame.crc;
+        memcpy(record.payload, frame.payload, frame.dlc);
+        return commit_();
+    }
+
+    /**
+     * Appends a receive fault, e.g. after tryReceive() returned frame_error.
+     * @param fault_reason The fault reason, see SerialCANBase::getFaultReason().
+     * @param receive_us Host time the fault occurred, in microseconds.
+     * @return False if a write failed.
+     */
+    bool writeFault(SerialCANBase::fault_reason fault_reason, uint64_t receive_us) {
+        nextRecord_(receive_us, fault_reason);
+        return commit_();
+    }
+
+    /**
+     * Writes the buffered records to the file.
+     * @return False if the write failed.
+     */
+    bool flush() {
+        size_t length = _n_records * sizeof(Record);
+        _n_records = 0;
+        return writeAll_(_records, length);
+    }
+
+    /**
+     * Flushes the buffered records and closes the file.
+     */
+    void close() {
+        if (_fd >= 0) {
+            flush();
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    /**
+     * Get the number of records written.
+     * @return The number of records, including buffered ones.
+     */
+    uint64_t getRecordCount() const { return _record_count; }
+
+ private:
+    /**
+     * Clears the next record in the buffer.
+     * @param receive_us Host receive time of the record.
+     * @param fault_reason Fault reason of the record.
+     * @return The record.
+     */
+    Record &nextRecord_(uint64_t receive_us, SerialCANBase::fault_reason fault_reason) {
+        Record &record = _records[_n_records];
+        memset(&record, 0, sizeof(record));
+        record.receive_us = receive_us;
+        record.fault_reason = fault_reason;
+        return record;
+    }
+
+    /**
+     * Adds the next record to the buffer, writing the buffer out when it is full.
+     * @return False if a write failed.
+     */
+    bool commit_() {
+        _record_count++;
+        if (++_n_records == max_records_) {
+            return flush();
+        }
+        return true;
+    }
+
+    /**
+     * Writes a buffer to the file.
+     * @param data The bytes to write.
+     * @param size The number of bytes to write.
+     * @return False if the write failed.
+     */
+    bool writeAll_(const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        while (size > 0 && _fd >= 0) {
+            ssize_t n = ::write(_fd, bytes, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n <= 0) {
+                return false;
+            }
+            bytes += n;
+            size -= n;
+        }
+        return size == 0;
+    }
+
+    static const size_t max_records_ = chunk_size / sizeof(Record);
+
+    int _fd = -1;                       /**< The capture file. */
+    Record _records[max_records_];      /**< Records not written yet. */
+    size_t _n_records = 0;              /**< Number of records in the buffer. */
+    uint64_t _record_count = 0;         /**< Number of records written. */
+};
+
+/**
+ * Reads a capture file by mapping it into memory. Records are accessed in place, without
+ * copying, in the order they were written.
+ * @tparam MaxDLC The payload capacity, which has to match the writer.
+ */
+template<size_t MaxDLC = MAX_DLC>
+class CaptureReader {
+ public:
+    typedef BasicCaptureRecord<MaxDLC> Record;
+
+    CaptureReader() = default;
+    ~CaptureReader() { close(); }
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    /**
+     * Maps a capture file and validates its header.
+     * @param path Path to the capture file.
+     * @return True if the file is a capture with matching record layout.
+     */
+    bool open(const char *path) {
+        close();
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 &&
+            static_cast<size_t>(file_stat.st_size) >= sizeof(CaptureHeader)) {
+            void *map = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                _map = static_cast<const uint8_t *>(map);
+                _map_size = file_stat.st_size;
+            }
+        }
+        ::close(fd);
+
+        const CaptureHeader *header = reinterpret_cast<const CaptureHeader *>(_map);
+        if (header == nullptr || memcmp(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) ||
+            header->version != CAPTURE_VERSION || header->record_size != sizeof(Record) ||
+            header->max_dlc != MaxDLC) {
+            close();
+            return false;
+        }
+
+        // A capture cut short by a crash ends with a partial record, which is ignored
+        _n_records = (_map_size - sizeof(CaptureHeader)) / sizeof(Record);
+        madvise(const_cast<uint8_t *>(_map), _map_size, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    /**
+     * Unmaps the capture file.
+     */
+    void close() {
+        if (_map != nullptr) {
+            munmap(const_cast<uint8_t *>(_map), _map_size);
+            _map = nullptr;
+        }
+        _map_size = 0;
+        _n_records = 0;
+    }
+
+    /**
+     * Get the number of records.
+     * @return The number of complete records in the file.
+     */
+    size_t size() const { return _n_records; }
+
+    /**
+     * Get a record.
+     * @param index The record index, smaller than size().
+     * @return The record, valid until the reader is closed.
+     */
+    const Record &operator[](size_t index) const { return begin()[index]; }
+
+    /**
+     * Get the first record, for iterating over all records.
+     * @return Pointer to the first record.
+     */
+    const Record *begin() const {
+        return reinterpret_cast<const Record *>(_map + sizeof(CaptureHeader));
+    }
+
+    /**
+     * Get the end of the records.
+     * @return Pointer past the last record.
+     */
+    const Record *end() const { return begin() + _n_records; }
+
+ private:
+    const uint8_t *_map = nullptr;      /**< The mapped file. */
+    size_t _map_size = 0;               /**< Size of the mapped file. */
+    size_t _n_records = 0;              /**< Number of complete records. */
+};
+
+/**
+ * Sends captured frames again with BasicSerialCAN::send(). Frames are sent with the timing
+ * they were captured with, scaled by a speed factor, or as fast as possible. Payloads are
+ * sent as captured, so counters and CRCs are not recomputed. Fault records and corrupt
+ * records are skipped.
+ * @tparam SerialCANT The SerialCAN type to send with, e.g. BasicSerialCAN<PosixStream>.
+ */
+template<typename SerialCANT>
+class CaptureReplay {
+ public:
+    typedef typename SerialCANT::FrameT FrameT;
+
+    /**
+     * Constructor for CaptureReplay class.
+     * @param serial_can The SerialCAN object to send with.
+     */
+    explicit CaptureReplay(SerialCANT *serial_can) : _serial_can{serial_can} {}
+
+    /**
+     * Sets the replay speed.
+     * @param speed 1 for the captured timing, 2 for twice as fast and so on, or 0 to send
+     *              as fast as possible.
+     */
+    void setSpeed(double speed) { _speed = speed; }
+
+    /**
+     * Sends a range of records, blocking until the last one has been sent.
+     * @param first The first record.
+     * @param last Past the last record.
+     * @return The number of frames sent.
+     */
+    template<typename RecordT>
+    size_t replay(const RecordT *first, const RecordT *last) {
+        typedef std::chrono::steady_clock clock;
+        clock::time_point start = clock::now();
+        uint64_t first_us = first != last ? first->receive_us : 0;
+        FrameT frame;
+        size_t n_frames = 0;
+
+        for (const RecordT *record = first; record != last; record++) {
+            if (record->fault_reason != SerialCANBase::none || !record->toFrame(&frame)) {
+                continue;
+            }
+
+            if (_speed > 0) {
+                std::this_thread::sleep_until(start + std::chrono::microseconds(
+                    static_cast<int64_t>((record->receive_us - first_us) / _speed)));
+            }
+
+            frame.use_crc = FrameBase::no_crc;
+            _serial_can->send(&frame, frame.timestamp);
+            n_frames++;
+        }
+
+        return n_frames;
+    }
+
+    /**
+     * Sends all records of a capture.
+     * @param reader The opened capture.
+     * @return The number of frames sent.
+     */
+    template<size_t MaxDLC>
+    size_t replay(const CaptureReader<MaxDLC> &reader) {
+        return replay(reader.begin(), reader.end());
+    }
+
+ private:
+    SerialCANT *_serial_can;            /**< The SerialCAN object to send with. */
+    double _speed = 1;                  /**< Replay speed factor, 0 for maximum speed. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_EXTRAS_HOST_CAPTURELOG_HPP_
@@ -0,0 +1,376 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_EXTRAS_HOST_HOSTSERIALCAN_HPP_
+#define SERIALCAN_EXTRAS_HOST_HOSTSERIALCAN_HPP_
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "SerialCAN.h"
+#include "PosixStream.hpp"
+#include "MpscQueue.hpp"
+
+namespace serial_can {
+
+/**
+ * Thread-safe SerialCAN endpoint for Linux hosts, e.g. a PC talking to the MCU over USB
+ * serial. A single I/O thread waits in epoll for the serial port and for an eventfd that
+ * is signalled when frames are queued. Incoming bytes are read in large chunks, so that
+ * many frames are parsed per read() call, and queued frames are written in batches.
+ *
+ * send() can be called from any number of threads, frames are handed to the I/O thread
+ * through a lock-free queue. Received frames are passed to the handler set with
+ * onReceive(), which runs on the I/O thread.
+ * @tparam MaxDLC The maximum payload length, MAX_DLC or MAX_FD_DLC.
+ * @tparam TxQueueSize The number of frames the transmit queue holds, a power of two.
+ */
+template<size_t MaxDLC = MAX_DLC, size_t TxQueueSize = 256>
+class HostSerialCAN {
+ public:
+    /**
+     * Type of the CAN frames sent and received.
+     */
+    typedef BasicFrame<MaxDLC> FrameT;
+
+    /**
+     * Type of the receive handler.
+     */
+    typedef std::function<void(const FrameT &)> ReceiveHandler;
+
+    /**
+     * Type of the handler for discarded incoming frames.
+     */
+    typedef std::function<void(SerialCANBase::fault_reason)> ErrorHandler;
+
+    /**
+     * Constructor for HostSerialCAN class.
+     * @param use_crc Whether the incoming frames are protected with CRC.
+     */
+    explicit HostSerialCAN(FrameBase::crc_settings use_crc = FrameBase::no_crc)
+        : _use_crc{use_crc} {}
+
+    ~HostSerialCAN() {
+        stop();
+    }
+
+    HostSerialCAN(const HostSerialCAN &) = delete;
+    HostSerialCAN &operator=(const HostSerialCAN &) = delete;
+
+    /**
+     * Opens and configures a serial device.
+     * @param path Path to the device, e.g. /dev/ttyACM0.
+     * @param baud_rate The baud rate for serial communication.
+     * @return True if the device was opened.
+     */
+    bool open(const char *path, uint32_t baud_rate) {
+        if (!_stream.open(path)) {
+            return false;
+        }
+        _serial_can.begin(baud_rate);
+        return true;
+    }
+
+    /**
+     * Uses an already open, non-blocking file descriptor, e.g. one side of a pty pair.
+     * The descriptor is closed with the endpoint.
+     * @param fd The file descriptor.
+     * @param baud_rate The baud rate, only applied if the descriptor is a terminal.
+     */
+    void attach(int fd, uint32_t baud_rate) {
+        _stream.attach(fd);
+        _serial_can.begin(baud_rate);
+    }
+
+    /**
+     * Sets the handler for received frames. Must be called before start().
+     * @param handler The handler, called on the I/O thread.
+     */
+    void onReceive(ReceiveHandler handler) { _receive_handler = handler; }
+
+    /**
+     * Sets the handler for discarded incoming frames, e.g. to log them in a capture.
+     * Must be called before start().
+     * @param handler The handler, called on the I/O thread with the fault reason.
+     */
+    void onError(ErrorHandler handler) { _error_handler = handler; }
+
+    /**
+     * Get the underlying SerialCAN object, e.g. to set the header format or framing.
+     * It must only be accessed before start().
+     * @return The SerialCAN object.
+     */
+    BasicSerialCAN<PosixStream, MaxDLC> &serialCAN() { return _serial_can; }
+
+    /**
+     * Starts the I/O thread.
+     * @return True if the thread was started.
+     */
+    bool start() {
+        if (_running || _stream.fd() < 0) {
+            return false;
+        }
+
+        _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_epoll_fd < 0 || _event_fd < 0) {
+            closeDescriptors_();
+            return false;
+        }
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = _event_fd;
+        epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _event_fd, &event);
+        event.data.fd = _stream.fd();
+        epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _stream.fd(), &event);
+        _poll_writable = false;
+        _connected = true;
+
+        _stream.setWriteBuffering(true);
+        _running = true;
+        _thread = std::thread(&HostSerialCAN::run_, this);
+        return true;
+    }
+
+    /**
+     * Stops the I/O thread without blocking on the descriptor. Frames still in the transmit
+     * queue are not sent, and neither are buffered bytes the descriptor does not accept.
+     */
+    void stop() {
+        if (!_running) {
+            return;
+        }
+        _running = false;
+        signal_();
+        _thread.join();
+        _stream.flushSome();
+        _stream.discardWriteBuffer();
+        _stream.setWriteBuffering(false);
+        closeDescriptors_();
+    }
+
+    /**
+     * Queues a frame for transmission. Can be called from any thread, as long as each frame
+     * object is only used by one thread at a time.
+     * @param outgoing_frame The outgoing CAN frame, copied into the queue. Its counter is
+     *                       advanced as if it was sent, like SerialCAN::send() does, so
+     *                       that consecutive frames carry consecutive counters.
+     * @param timestamp The timestamp of the CAN frame.
+     * @return True if the frame was queued, false if the transmit queue is full. A rejected
+     *         frame is left untouched.
+     */
+    bool send(FrameT *outgoing_frame, uint32_t timestamp) {
+        FrameT queued_frame = *outgoing_frame;
+        queued_frame.timestamp = timestamp;
+        if (!_tx_queue.push(queued_frame)) {
+            _dropped_frames.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        outgoing_frame->counter++;
+
+        // Only the first frame after the I/O thread has drained the queue wakes it up
+        if (!_wakeup_pending.exchange(true)) {
+            signal_();
+        }
+        return true;
+    }
+
+    /**
+     * Get the number of frames received.
+     * @return The number of frames passed to the receive handler.
+     */
+    uint64_t getReceivedFrameCount() const { return _received_frames.load(); }
+
+    /**
+     * Get the number of frames sent.
+     * @return The number of frames written to the serial port.
+     */
+    uint64_t getSentFrameCount() const { return _sent_frames.load(); }
+
+    /**
+     * Get the number of frames rejected by send() because the transmit queue was full.
+     * @return The number of dropped frames.
+     */
+    uint64_t getDroppedFrameCount() const { return _dropped_frames.load(); }
+
+    /**
+     * Get the number of incoming frames discarded by the codec.
+     * @return The number of frame errors.
+     */
+    uint64_t getFrameErrorCount() const { return _frame_errors.load(); }
+
+    /**
+     * Get whether the serial port is connected.
+     * @return False after the I/O thread has seen a hangup or error on the serial port.
+     */
+    bool isConnected() const { return _connected; }
+
+ private:
+    /**
+     * The I/O thread.
+     */
+    void run_() {
+        struct epoll_event events[2];
+
+        while (_running) {
+            int n_events = epoll_wait(_epoll_fd, events, 2, -1);
+
+            for (int i = 0; i < n_events; i++) {
+                if (events[i].data.fd == _event_fd) {
+                    uint64_t count;
+                    ssize_t n = ::read(_event_fd, &count, sizeof(count));
+                    (void)n;
+                    _wakeup_pending = false;
+                } else {
+                    receive_();
+                    if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                        disconnect_();
+                    }
+                }
+            }
+
+            transmit_();
+        }
+    }
+
+    /**
+     * Parses all bytes that can be read without blocking.
+     */
+    void receive_() {
+        FrameT incoming_frame{_use_crc};
+        SerialCANBase::receive_status status;
+
+        while ((status = _serial_can.tryReceive(&incoming_frame)) !=
+               SerialCANBase::need_more_bytes) {
+            if (status == SerialCANBase::frame_ready) {
+                _received_frames.fetch_add(1, std::memory_order_relaxed);
+                if (_receive_handler) {
+                    _receive_handler(incoming_frame);
+                }
+            } else {
+                _frame_errors.fetch_add(1, std::memory_order_relaxed);
+                if (_error_handler) {
+                    _error_handler(_serial_can.getFaultReason());
+                }
+            }
+        }
+    }
+
+    /**
+     * Encodes queued frames into the write buffer and writes as much as the serial port
+     * accepts. The I/O thread never blocks on write(), so that a peer that is sending at
+     * the same time is still read. The port is polled for writability while bytes or
+     * frames are left over.
+     */
+    void transmit_() {
+        FrameT outgoing_frame;
+
+        if (!_connected) {
+            return;
+        }
+
+        for (;;) {
+            while (_stream.availableForWrite() >= _serial_can.max_wire_size) {
+                if (!_tx_queue.pop(&outgoing_frame)) {
+                    break;
+                }
+                _serial_can.send(&outgoing_frame, outgoing_frame.timestamp);
+                _sent_frames.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (_stream.flushSome() == 0 || _stream.getWriteBufferLength() > 0) {
+                break;
+            }
+        }
+
+        bool poll_writable = _stream.getWriteBufferLength() > 0;
+        if (poll_writable != _poll_writable) {
+            struct epoll_event event = {};
+            event.events = poll_writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+            event.data.fd = _stream.fd();
+            epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, _stream.fd(), &event);
+            _poll_writable = poll_writable;
+        }
+    }
+
+    /**
+     * Stops polling the serial port after a hangup, e.g. when a USB device is unplugged.
+     */
+    void disconnect_() {
+        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, _stream.fd(), nullptr);
+        _connected = false;
+    }
+
+    /**
+     * Wakes up the I/O thread.
+     */
+    void signal_() {
+        uint64_t count = 1;
+        ssize_t n = ::write(_event_fd, &count, sizeof(count));
+        (void)n;
+    }
+
+    /**
+     * Closes the epoll and eventfd descriptors.
+     */
+    void closeDescriptors_() {
+        if (_epoll_fd >= 0) {
+            ::close(_epoll_fd);
+            _epoll_fd = -1;
+        }
+        if (_event_fd >= 0) {
+            ::close(_event_fd);
+            _event_fd = -1;
+        }
+    }
+
+    PosixStream _stream;                                /**< The serial port. */
+    BasicSerialCAN<PosixStream, MaxDLC> _serial_can{&_stream};  /**< The codec. */
+    FrameBase::crc_settings _use_crc;                   /**< CRC setting of incoming frames. */
+    ReceiveHandler _receive_handler;                    /**< Handler for received frames. */
+    ErrorHandler _error_handler;                        /**< Handler for discarded frames. */
+    MpscQueue<FrameT, TxQueueSize> _tx_queue;           /**< Frames waiting to be sent. */
+    std::thread _thread;                                /**< The I/O thread. */
+    std::atomic<bool> _running{false};                  /**< Whether the I/O thread runs. */
+    std::atomic<bool> _wakeup_pending{false};           /**< Whether the eventfd is signalled. */
+    int _epoll_fd = -1;                                 /**< The epoll instance. */
+    int _event_fd = -1;                                 /**< Wakes up the I/O thread. */
+    bool _poll_writable = false;                        /**< Whether EPOLLOUT is registered. */
+    std::atomic<bool> _connected{false};                /**< Whether the port is polled. */
+    std::atomic<uint64_t> _received_frames{0};          /**< Number of received frames. */
+    std::atomic<uint64_t> _sent_frames{0};              /**< Number of sent frames. */
+    std::atomic<uint64_t> _dropped_frames{0};           /**< Number of rejected frames. */
+    std::atomic<uint64_t> _frame_errors{0};             /**< Number of discarded frames. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_EXTRAS_HOST_HOSTSERIALCAN_HPP_
@@ -0,0 +1,133 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_EXTRAS_HOST_MPSCQUEUE_HPP_
+#define SERIALCAN_EXTRAS_HOST_MPSCQUEUE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace serial_can {
+
+/**
+ * Bounded lock-free queue with any number of producer threads and a single consumer
+ * thread. Each slot carries a sequence number that tells whether it is free, being written
+ * or ready, so producers only contend on a single compare-and-swap of the tail index.
+ * @tparam T The element type, which must be copy assignable.
+ * @tparam Capacity The number of slots, a power of two.
+ */
+template<typename T, size_t Capacity>
+class MpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpscQueue capacity must be a power of two");
+
+ public:
+    MpscQueue() {
+        for (size_t i = 0; i < Capacity; i++) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    /**
+     * Adds an element. Can be called from any thread.
+     * @param value The element to add.
+     * @return True if the element was added, false if the queue is full.
+     */
+    bool push(const T &value) {
+        size_t position = _tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Slot &slot = _slots[position & (Capacity - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence - position);
+
+            if (difference == 0) {
+                // The slot is free, claim it by moving the tail
+                if (_tail.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The consumer has not released the slot yet
+                return false;
+            } else {
+                // Another producer claimed the slot first
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Removes the oldest element. Must only be called from the consumer thread.
+     * @param value Set to the removed element.
+     * @return True if an element was removed, false if the queue is empty or the oldest
+     *         element is still being written.
+     */
+    bool pop(T *value) {
+        Slot &slot = _slots[_head & (Capacity - 1)];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (static_cast<intptr_t>(sequence - (_head + 1)) < 0) {
+            return false;
+        }
+
+        *value = slot.value;
+        slot.sequence.store(_head + Capacity, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    /**
+     * Get the capacity of the queue.
+     * @return The number of slots.
+     */
+    static constexpr size_t capacity() { return Capacity; }
+
+ private:
+    /**
+     * Queue slot with its sequence number.
+     */
+    struct Slot {
+        std::atomic<size_t> sequence;   /**< Position the slot is free or ready for. */
+        T value;                        /**< The element. */
+    };
+
+    Slot _slots[Capacity];                          /**< The slots. */
+    uint8_t _padding[64];                           /**< Keeps the indices on separate lines. */
+    std::atomic<size_t> _tail{0};                   /**< Next position to claim. */
+    uint8_t _tail_padding[64];                      /**< Keeps the indices on separate lines. */
+    size_t _head = 0;                               /**< Next position to consume. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_EXTRAS_HOST_MPSCQUEUE_HPP_
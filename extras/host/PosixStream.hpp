@@ -0,0 +1,324 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_EXTRAS_HOST_POSIXSTREAM_HPP_
+#define SERIALCAN_EXTRAS_HOST_POSIXSTREAM_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace serial_can {
+
+/**
+ * Stream over a POSIX file descriptor (serial port, pty, pipe or socket) for host builds
+ * of BasicSerialCAN. Incoming bytes are read in large chunks, so that many frames are
+ * parsed per read() system call.
+ */
+class PosixStream {
+ public:
+    static const size_t read_buffer_size = 4096;  /**< Size of the read buffer in bytes. */
+    static const size_t write_buffer_size = 4096;  /**< Size of the write buffer in bytes. */
+
+    /**
+     * Constructor for PosixStream class.
+     * @param fd An already open, non-blocking file descriptor, or -1 to use open().
+     */
+    explicit PosixStream(int fd = -1) : _fd{fd} {}
+
+    ~PosixStream() { close(); }
+
+    PosixStream(const PosixStream &) = delete;
+    PosixStream &operator=(const PosixStream &) = delete;
+
+    /**
+     * Opens a serial device or pty in non-blocking mode.
+     * @param path Path to the device, e.g. /dev/ttyACM0.
+     * @return True if the device was opened.
+     */
+    bool open(const char *path) {
+        close();
+        _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        return _fd >= 0;
+    }
+
+    /**
+     * Uses an already open, non-blocking file descriptor, closing the current one.
+     * @param fd The file descriptor.
+     */
+    void attach(int fd) {
+        close();
+        _fd = fd;
+    }
+
+    /**
+     * Closes the file descriptor.
+     */
+    void close() {
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+        _read_pos = _read_end = 0;
+        _write_length = 0;
+    }
+
+    /**
+     * Configures a terminal device for raw 8N1 communication.
+     * File descriptors that are not terminals are left untouched.
+     * @param baud_rate The baud rate for serial communication.
+     */
+    void begin(uint32_t baud_rate) {
+        struct termios tty;
+        if (_fd < 0 || tcgetattr(_fd, &tty) != 0) {
+            return;
+        }
+
+        cfmakeraw(&tty);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+
+        speed_t speed = toSpeed_(baud_rate);
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+        tcsetattr(_fd, TCSANOW, &tty);
+    }
+
+    /**
+     * Get the number of bytes that can be read without blocking.
+     * Refills the read buffer with a single read() call when it is empty.
+     * @return The number of buffered bytes.
+     */
+    int available() {
+        if (_read_pos == _read_end) {
+            fill_();
+        }
+        return static_cast<int>(_read_end - _read_pos);
+    }
+
+    /**
+     * Reads one byte.
+     * @return The byte, or -1 if no byte is available.
+     */
+    int read() {
+        if (available() == 0) {
+            return -1;
+        }
+        return _read_buffer[_read_pos++];
+    }
+
+    /**
+     * Writes one byte.
+     * @param val The byte to write.
+     * @return The number of bytes written.
+     */
+    size_t write(uint8_t val) { return write(&val, 1); }
+
+    /**
+     * Writes a buffer, waiting for the descriptor to become writable when needed.
+     * With write buffering enabled the bytes are appended to the write buffer instead,
+     * and only written directly if they do not fit.
+     * @param buffer The bytes to write.
+     * @param size The number of bytes to write.
+     * @return The number of bytes written.
+     */
+    size_t write(const uint8_t *buffer, size_t size) {
+        if (_write_buffering) {
+            if (size <= availableForWrite()) {
+                memcpy(&_write_buffer[_write_length], buffer, size);
+                _write_length += size;
+                return size;
+            }
+            // Keep the byte order, the buffered bytes go first
+            writeAll_(_write_buffer, _write_length);
+            _write_length = 0;
+        }
+        return writeAll_(buffer, size);
+    }
+
+    /**
+     * Enables or disables write buffering. Buffered bytes are written by flushSome(), so
+     * that a batch of frames is written with a single write() system call.
+     * @param enabled Whether writes are buffered.
+     */
+    void setWriteBuffering(bool enabled) {
+        if (!enabled && _write_length > 0) {
+            writeAll_(_write_buffer, _write_length);
+            _write_length = 0;
+        }
+        _write_buffering = enabled;
+    }
+
+    /**
+     * Get the number of bytes that can be written without blocking.
+     * @return The free space in the write buffer if write buffering is enabled. Otherwise
+     *         PIPE_BUF if the descriptor is writable right now, and 0 if it is not.
+     */
+    size_t availableForWrite() const {
+        if (_write_buffering) {
+            return write_buffer_size - _write_length;
+        }
+        if (_fd < 0) {
+            return 0;
+        }
+        struct pollfd pfd = {_fd, POLLOUT, 0};
+        int n;
+        do {
+            n = ::poll(&pfd, 1, 0);
+        } while (n < 0 && errno == EINTR);
+        return n > 0 && (pfd.revents & POLLOUT) ? PIPE_BUF : 0;
+    }
+
+    /**
+     * Writes as many buffered bytes as the descriptor accepts without blocking.
+     * @return The number of bytes written.
+     */
+    size_t flushSome() {
+        if (_write_length == 0 || _fd < 0) {
+            return 0;
+        }
+        ssize_t n;
+        do {
+            n = ::write(_fd, _write_buffer, _write_length);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            return 0;
+        }
+        _write_length -= n;
+        memmove(_write_buffer, &_write_buffer[n], _write_length);
+        return n;
+    }
+
+    /**
+     * Drops the buffered bytes that have not been written yet.
+     */
+    void discardWriteBuffer() { _write_length = 0; }
+
+    /**
+     * Get the number of buffered bytes not yet written.
+     * @return The number of bytes in the write buffer.
+     */
+    size_t getWriteBufferLength() const { return _write_length; }
+
+    /**
+     * Get the file descriptor, e.g. for registration with poll() or epoll.
+     * @return The file descriptor.
+     */
+    int fd() const { return _fd; }
+
+ private:
+    /**
+     * Writes a buffer, waiting for the descriptor to become writable when needed.
+     * @param buffer The bytes to write.
+     * @param size The number of bytes to write.
+     * @return The number of bytes written.
+     */
+    size_t writeAll_(const uint8_t *buffer, size_t size) {
+        size_t written = 0;
+        while (written < size && _fd >= 0) {
+            ssize_t n = ::write(_fd, buffer + written, size - written);
+            if (n > 0) {
+                written += n;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct pollfd pfd = {_fd, POLLOUT, 0};
+                ::poll(&pfd, 1, -1);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+        return written;
+    }
+
+    /**
+     * Reads as many bytes as are available into the empty read buffer.
+     */
+    void fill_() {
+        _read_pos = _read_end = 0;
+        if (_fd < 0) {
+            return;
+        }
+        ssize_t n;
+        do {
+            n = ::read(_fd, _read_buffer, sizeof(_read_buffer));
+        } while (n < 0 && errno == EINTR);
+        if (n > 0) {
+            _read_end = n;
+        }
+    }
+
+    /**
+     * Maps a baud rate to a termios speed constant.
+     * @param baud_rate The baud rate.
+     * @return The termios speed, B115200 for unsupported rates.
+     */
+    static speed_t toSpeed_(uint32_t baud_rate) {
+        switch (baud_rate) {
+            case 9600: return B9600;
+            case 19200: return B19200;
+            case 38400: return B38400;
+            case 57600: return B57600;
+            case 115200: return B115200;
+            case 230400: return B230400;
+#ifdef B460800
+            case 460800: return B460800;
+#endif
+#ifdef B921600
+            case 921600: return B921600;
+#endif
+#ifdef B1000000
+            case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+            case 2000000: return B2000000;
+#endif
+#ifdef B4000000
+            case 4000000: return B4000000;
+#endif
+            default: return B115200;
+        }
+    }
+
+    int _fd;                                   /**< The file descriptor. */
+    uint8_t _read_buffer[read_buffer_size];    /**< Bytes read but not consumed yet. */
+    size_t _read_pos = 0;                      /**< Next byte to consume. */
+    size_t _read_end = 0;                      /**< End of the buffered bytes. */
+    uint8_t _write_buffer[write_buffer_size];  /**< Bytes written but not flushed yet. */
+    size_t _write_length = 0;                  /**< Number of bytes in the write buffer. */
+    bool _write_buffering = false;             /**< Whether writes are buffered. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_EXTRAS_HOST_POSIXSTREAM_HPP_
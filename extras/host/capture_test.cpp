@@ -0,0 +1,254 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+// Test of the capture log. Writes a capture of a million frames, reads it back through
+// the memory-mapped reader and replays it over a pty pair at maximum speed, which doubles
+// as a load test of HostSerialCAN. A short replay at scaled timing checks the pacing, and a
+// capture with a corrupt record checks that it is skipped.
+// Exits non-zero if a record or frame does not match.
+
+#include <fcntl.h>
+#include <pty.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+#include "CaptureLog.hpp"
+#include "HostSerialCAN.hpp"
+
+using serial_can::BasicSerialCAN;
+using serial_can::CaptureReader;
+using serial_can::CaptureReplay;
+using serial_can::CaptureWriter;
+using serial_can::Frame;
+using serial_can::HostSerialCAN;
+using serial_can::PosixStream;
+using serial_can::SerialCANBase;
+
+namespace {
+
+const uint32_t n_records = 1000000;
+const uint32_t fault_interval = 1000;   // Every 1000th record is a fault
+const uint64_t record_interval_us = 100;
+
+/**
+ * Arbitration ID of the frame with the given index.
+ */
+uint32_t frameId(uint32_t index) {
+    return 0x100 + (index & 0xFF);
+}
+
+/**
+ * Stand-in for SerialCAN that counts the frames sent by a replay.
+ */
+struct CountingSerialCAN {
+    typedef Frame FrameT;
+    size_t n_frames = 0;
+
+    void send(FrameT *frame, uint32_t timestamp) {
+        static_cast<void>(frame);
+        static_cast<void>(timestamp);
+        n_frames++;
+    }
+};
+
+/**
+ * Writes a capture of three frames and corrupts the DLC of the second record, which has
+ * to be skipped by toFrame() and the replay instead of overflowing the frame payload.
+ * @param path The capture file.
+ * @return The number of errors.
+ */
+uint32_t testCorruptRecord(const char *path) {
+    CaptureWriter<> writer;
+    Frame frame{0x100, 8};
+    if (!writer.open(path)) {
+        return 1;
+    }
+    for (int i = 0; i < 3; i++) {
+        writer.write(frame, i);
+    }
+    writer.close();
+
+    int fd = ::open(path, O_WRONLY);
+    uint8_t corrupt_dlc = 200;
+    off_t offset = sizeof(serial_can::CaptureHeader) + sizeof(CaptureReader<>::Record) +
+        offsetof(CaptureReader<>::Record, dlc);
+    bool patched = fd >= 0 && pwrite(fd, &corrupt_dlc, 1, offset) == 1;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+
+    CaptureReader<> reader;
+    if (!patched || !reader.open(path) || reader.size() != 3) {
+        return 1;
+    }
+
+    uint32_t errors = 0;
+    Frame incoming_frame{};
+    errors += !reader.begin()[0].toFrame(&incoming_frame);
+    errors += reader.begin()[1].toFrame(&incoming_frame);
+
+    CountingSerialCAN serial_can;
+    CaptureReplay<CountingSerialCAN> replay{&serial_can};
+    replay.setSpeed(0);
+    errors += replay.replay(reader) != 2 || serial_can.n_frames != 2;
+    reader.close();
+
+    printf("corrupt record test, %u errors\n", errors);
+    return errors;
+}
+
+}  // namespace
+
+int main() {
+    char path[] = "/tmp/serialcan_capture_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    ::close(fd);
+    uint32_t errors = testCorruptRecord(path);
+
+    // Capture
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    CaptureWriter<> writer;
+    if (!writer.open(path)) {
+        perror("open");
+        return 1;
+    }
+    Frame frame{0x100, 8, Frame::crc8};
+    for (uint32_t i = 0; i < n_records; i++) {
+        uint64_t receive_us = i * record_interval_us;
+        if (i % fault_interval == fault_interval - 1) {
+            writer.writeFault(SerialCANBase::crc_mismatch, receive_us);
+            continue;
+        }
+        frame.arbitration_id = frameId(i);
+        frame.timestamp = i;
+        // Payloads are captured with the counter and CRC bytes as sent
+        memcpy(frame.payload, &i, sizeof(i));
+        frame.counter = frame.payload[6] = static_cast<uint8_t>(i);
+        frame.crc = frame.payload[7] = serial_can::crc8(frame.payload, 7);
+        writer.write(frame, receive_us);
+    }
+    writer.close();
+    double write_s = std::chrono::duration<double>(clock::now() - start).count();
+
+    // Read back
+    start = clock::now();
+    CaptureReader<> reader;
+    if (!reader.open(path) || reader.size() != n_records) {
+        printf("capture could not be read back\n");
+        return 1;
+    }
+    uint32_t index = 0;
+    uint32_t n_faults = 0;
+    for (const CaptureReader<>::Record &record : reader) {
+        uint32_t value;
+        memcpy(&value, record.payload, sizeof(value));
+        if (record.fault_reason != SerialCANBase::none) {
+            n_faults++;
+            errors += record.fault_reason != SerialCANBase::crc_mismatch;
+        } else if (record.arbitration_id != frameId(index) || record.timestamp != index ||
+                   value != index || record.receive_us != index * record_interval_us ||
+                   record.use_crc != Frame::crc8) {
+            errors++;
+        }
+        index++;
+    }
+    double read_s = std::chrono::duration<double>(clock::now() - start).count();
+    printf("wrote %u records in %.3f s, read them in %.3f s, %u faults, %u errors\n",
+        n_records, write_s, read_s, n_faults, errors);
+
+    // Replay over a pty pair as fast as possible
+    int master_fd, slave_fd;
+    if (openpty(&master_fd, &slave_fd, nullptr, nullptr, nullptr) != 0) {
+        perror("openpty");
+        return 1;
+    }
+    fcntl(master_fd, F_SETFL, O_NONBLOCK);
+    fcntl(slave_fd, F_SETFL, O_NONBLOCK);
+
+    PosixStream stream{master_fd};
+    BasicSerialCAN<PosixStream> serial_can{&stream};
+    serial_can.begin(2000000);
+    HostSerialCAN<> device{Frame::crc8};
+    std::atomic<uint32_t> received{0};
+    std::atomic<uint32_t> receive_errors{0};
+    std::atomic<uint32_t> next_index{0};
+    device.attach(slave_fd, 2000000);
+    device.onReceive([&](const Frame &incoming_frame) {
+        // Fault records are skipped by the replay
+        if (next_index % fault_interval == fault_interval - 1) {
+            next_index++;
+        }
+        receive_errors += incoming_frame.arbitration_id != frameId(next_index) ||
+            incoming_frame.timestamp != next_index;
+        next_index++;
+        received++;
+    });
+    device.start();
+
+    CaptureReplay<BasicSerialCAN<PosixStream> > replay{&serial_can};
+    replay.setSpeed(0);
+    start = clock::now();
+    size_t n_sent = replay.replay(reader);
+    const uint32_t expected = n_records - n_records / fault_interval;
+    clock::time_point deadline = clock::now() + std::chrono::seconds(10);
+    while (received < expected && clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double replay_s = std::chrono::duration<double>(clock::now() - start).count();
+    printf("replayed %zu frames, received %u in %.3f s, %.0f frames/s\n",
+        n_sent, received.load(), replay_s, received / replay_s);
+    errors += n_sent != expected || received != expected;
+
+    // Replay 200 records, 20 ms of capture, at twice the speed. The device is idle once
+    // every frame has been received, so its index can be rewound.
+    next_index = 0;
+    replay.setSpeed(2);
+    start = clock::now();
+    replay.replay(reader.begin(), reader.begin() + 200);
+    double scaled_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    deadline = clock::now() + std::chrono::seconds(1);
+    while (received < expected + 200 && clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    printf("replayed 20 ms of capture at speed 2 in %.1f ms\n", scaled_ms);
+    errors += scaled_ms < 9.9 || received != expected + 200;
+
+    device.stop();
+    errors += receive_errors + device.getFrameErrorCount();
+    reader.close();
+    unlink(path);
+
+    printf("%s\n", errors == 0 ? "PASSED" : "FAILED");
+    return errors == 0 ? 0 : 1;
+}
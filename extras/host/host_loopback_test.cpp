@@ -0,0 +1,230 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+// Loopback test of HostSerialCAN over a pty pair, no hardware needed.
+// Several threads send frames concurrently on one end of the pty while the other end sends
+// frames back, and every frame is checked for order and content, including the CRC counter
+// of each producer's ID. Prints the throughput and exits non-zero if a frame is lost,
+// reordered or corrupted.
+
+#include <fcntl.h>
+#include <pty.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "HostSerialCAN.hpp"
+
+using serial_can::BasicSerialCAN;
+using serial_can::Frame;
+using serial_can::HostSerialCAN;
+using serial_can::PosixStream;
+using serial_can::SequenceStatistics;
+using serial_can::StaticSequenceTracker;
+
+namespace {
+
+const int n_producers = 4;
+const uint32_t frames_per_producer = 20000;
+const uint32_t reply_frames = 20000;
+
+/**
+ * Checks that the frames of each producer arrive in order.
+ */
+struct Checker {
+    uint32_t next_sequence[n_producers + 1] = {};
+    uint32_t errors = 0;
+    std::atomic<uint32_t> received{0};
+
+    void check(const Frame &frame) {
+        uint8_t producer = frame.payload[0];
+        uint32_t sequence = 0;
+        memcpy(&sequence, &frame.payload[1], sizeof(sequence));
+
+        if (producer > n_producers || frame.arbitration_id != 0x100u + producer ||
+            sequence != next_sequence[producer]) {
+            errors++;
+        } else {
+            next_sequence[producer]++;
+        }
+        received++;
+    }
+};
+
+/**
+ * Sends frames numbered from 0, retrying while the transmit queue is full.
+ */
+void produce(HostSerialCAN<> *endpoint, uint8_t producer, uint32_t n_frames) {
+    Frame frame{0x100u + producer, 8, Frame::crc8};
+    frame.payload[0] = producer;
+
+    for (uint32_t sequence = 0; sequence < n_frames; sequence++) {
+        memcpy(&frame.payload[1], &sequence, sizeof(sequence));
+        while (!endpoint->send(&frame, sequence)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * Sends a frame with trySend() over an unbuffered PosixStream, which has to be written by
+ * flushSome() as soon as the pipe is writable.
+ * @return The number of errors.
+ */
+uint32_t testUnbufferedTrySend() {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return 1;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    PosixStream stream{fds[1]};
+    BasicSerialCAN<PosixStream> serial_can{&stream};
+    uint8_t tx_queue[BasicSerialCAN<PosixStream>::max_wire_size];
+    serial_can.begin(2000000);
+    serial_can.enableTxQueue(tx_queue, sizeof(tx_queue));
+
+    Frame frame{0x100, 8};
+    uint32_t errors = stream.availableForWrite() == 0;
+    errors += !serial_can.trySend(&frame, 0);
+    errors += serial_can.getTxQueueLength() != 0;
+
+    uint8_t bytes[sizeof(tx_queue)];
+    errors += read(fds[0], bytes, sizeof(bytes)) <= 0;
+    ::close(fds[0]);
+
+    printf("unbuffered trySend test, %u errors\n", errors);
+    return errors;
+}
+
+/**
+ * Stops an endpoint whose peer never reads, which must not wait for the socket to drain.
+ * @return The number of errors.
+ */
+uint32_t testStopWhileBlocked() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return 1;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    HostSerialCAN<> endpoint;
+    endpoint.attach(fds[0], 2000000);
+    endpoint.start();
+    // Keep the transmit queue full until the socket buffer has filled up
+    Frame frame{0x100, 8};
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    for (uint32_t sequence = 0; std::chrono::steady_clock::now() < deadline; sequence++) {
+        endpoint.send(&frame, sequence);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    endpoint.stop();
+    uint32_t errors = std::chrono::steady_clock::now() - start > std::chrono::seconds(1);
+    ::close(fds[1]);
+
+    printf("stop while blocked test, %u errors\n", errors);
+    return errors;
+}
+
+}  // namespace
+
+int main() {
+    uint32_t unbuffered_errors = testUnbufferedTrySend() + testStopWhileBlocked();
+
+    int master_fd, slave_fd;
+    if (openpty(&master_fd, &slave_fd, nullptr, nullptr, nullptr) != 0) {
+        perror("openpty");
+        return 1;
+    }
+    fcntl(master_fd, F_SETFL, O_NONBLOCK);
+    fcntl(slave_fd, F_SETFL, O_NONBLOCK);
+
+    HostSerialCAN<> host{Frame::crc8};
+    HostSerialCAN<> device{Frame::crc8};
+    Checker host_checker, device_checker;
+    StaticSequenceTracker<n_producers + 1> host_tracker, device_tracker;
+
+    host.attach(master_fd, 2000000);
+    device.attach(slave_fd, 2000000);
+    host.serialCAN().setSequenceTracker(&host_tracker);
+    device.serialCAN().setSequenceTracker(&device_tracker);
+    host.onReceive([&host_checker](const Frame &frame) { host_checker.check(frame); });
+    device.onReceive([&device_checker](const Frame &frame) { device_checker.check(frame); });
+    host.start();
+    device.start();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int i = 0; i < n_producers; i++) {
+        producers.emplace_back(produce, &host, static_cast<uint8_t>(i), frames_per_producer);
+    }
+    // The device answers at the same time, with its own producer number
+    producers.emplace_back(produce, &device, static_cast<uint8_t>(n_producers), reply_frames);
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    const uint32_t expected = n_producers * frames_per_producer;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((device_checker.received < expected || host_checker.received < reply_frames) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    host.stop();
+    device.stop();
+
+    // Every frame continues the counter sequence of its ID
+    uint32_t counter_errors = 0;
+    for (const SequenceStatistics *statistics :
+         {&host_tracker.getStatistics(), &device_tracker.getStatistics()}) {
+        counter_errors += statistics->lost_frames + statistics->repeated_frames +
+            statistics->out_of_order_frames + statistics->untracked_frames;
+    }
+    counter_errors += host_tracker.getStatistics().in_order_frames != reply_frames;
+    counter_errors += device_tracker.getStatistics().in_order_frames != expected;
+
+    uint32_t errors = unbuffered_errors + host_checker.errors + device_checker.errors +
+        counter_errors + host.getFrameErrorCount() + device.getFrameErrorCount();
+    printf("host -> device: %u/%u frames, device -> host: %u/%u frames\n",
+        device_checker.received.load(), expected, host_checker.received.load(), reply_frames);
+    printf("errors: %u, queue full: %llu, %.0f frames/s\n", errors,
+        static_cast<unsigned long long>(host.getDroppedFrameCount() +
+                                        device.getDroppedFrameCount()),
+        (device_checker.received + host_checker.received) / seconds);
+
+    bool passed = errors == 0 && device_checker.received == expected &&
+        host_checker.received == reply_frames;
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
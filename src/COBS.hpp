@@ -0,0 +1,148 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_COBS_HPP_
+#define SERIALCAN_SRC_COBS_HPP_
+
+#include "Utils.hpp"
+
+namespace serial_can {
+
+/**
+ * Gets the maximum number of bytes that Consistent Overhead Byte Stuffing adds to a block.
+ * @param length The block length in bytes.
+ * @return The maximum overhead in bytes, excluding the delimiter.
+ */
+constexpr size_t cobsMaxOverhead(size_t length) { return length / 254 + 1; }
+
+/**
+ * Encodes a block with Consistent Overhead Byte Stuffing, so that it contains no 0x00
+ * bytes and can be delimited by one. The delimiter is not written.
+ * The encoding may be done in place, if buffer starts at least cobsMaxOverhead(length)
+ * bytes before data.
+ * @param data The block to be encoded.
+ * @param length The block length in bytes.
+ * @param buffer Destination with room for length + cobsMaxOverhead(length) bytes.
+ * @return The number of bytes written to buffer.
+ */
+inline size_t cobsEncode(const uint8_t *data, size_t length, uint8_t *buffer) {
+    size_t code_pos = 0;
+    size_t write_pos = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        uint8_t data_byte = data[i];
+
+        if (data_byte != 0) {
+            buffer[write_pos++] = data_byte;
+            code++;
+        }
+
+        // A zero or a full group of 254 bytes closes the group
+        if (data_byte == 0 || code == 0xFF) {
+            buffer[code_pos] = code;
+            code_pos = write_pos++;
+            code = 1;
+        }
+    }
+
+    buffer[code_pos] = code;
+    return write_pos;
+}
+
+/**
+ * Streaming decoder for blocks encoded with cobsEncode() and delimited by 0x00.
+ * Decodes one byte at a time without buffering, so a block never has to be held in
+ * encoded form, and any 0x00 byte ends the block, which makes the next block boundary
+ * unambiguous after corruption.
+ */
+class CobsDecoder {
+ public:
+    /**
+     * Result of decoding one byte.
+     */
+    enum result {
+        no_data,                  /**< A group code byte, no data byte was decoded */
+        data_ready,               /**< A data byte was decoded */
+        end_of_block              /**< The delimiter ended the block */
+    };
+
+    /**
+     * Decodes one encoded byte.
+     * @param encoded_byte The encoded byte.
+     * @param data_byte The decoded byte, populated if data_ready is returned.
+     * @return The decoding result.
+     */
+    result decode(uint8_t encoded_byte, uint8_t *data_byte) {
+        if (encoded_byte == 0) {
+            reset();
+            return end_of_block;
+        }
+
+        if (_remaining > 0) {
+            _remaining--;
+            *data_byte = encoded_byte;
+            _decoded++;
+            return data_ready;
+        }
+
+        // Group code byte, the previous group ended with an implicit zero unless it was full
+        bool zero_pending = _zero_pending;
+        _remaining = encoded_byte - 1;
+        _zero_pending = encoded_byte != 0xFF;
+
+        if (zero_pending) {
+            *data_byte = 0;
+            _decoded++;
+            return data_ready;
+        }
+        return no_data;
+    }
+
+    /**
+     * Restarts decoding at the beginning of a block.
+     */
+    void reset() {
+        _remaining = 0;
+        _zero_pending = false;
+        _decoded = 0;
+    }
+
+    /**
+     * Get the number of bytes decoded in the current block.
+     * @return The number of decoded bytes.
+     */
+    size_t decoded() const { return _decoded; }
+
+ private:
+    uint8_t _remaining = 0;       /**< Data bytes left in the current group. */
+    bool _zero_pending = false;   /**< The current group ends with an implicit zero. */
+    size_t _decoded = 0;          /**< Bytes decoded in the current block. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_COBS_HPP_
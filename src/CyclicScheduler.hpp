@@ -0,0 +1,338 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_CYCLICSCHEDULER_HPP_
+#define SERIALCAN_SRC_CYCLICSCHEDULER_HPP_
+
+#include "SerialCAN.h"
+
+namespace serial_can {
+
+/**
+ * Transmit statistics of one scheduled frame.
+ */
+struct CyclicStatistics {
+    uint32_t sent_frames;       /**< Number of times the frame was sent. */
+    uint32_t missed_deadlines;  /**< Number of periods in which the frame was not sent. */
+    uint32_t last_jitter_us;    /**< Delay of the last transmission after its due time. */
+    uint32_t max_jitter_us;     /**< Largest delay of a transmission after its due time. */
+};
+
+/**
+ * Static schedule of periodic frames. Each frame is registered with a period and a phase
+ * offset, and tick() sends every frame that is due, so that periodic traffic does not need
+ * ad-hoc millis() checks around send().
+ *
+ * Frames registered without a phase get the phase whose releases are furthest from those
+ * of the frames already scheduled, which spreads the frames evenly over time instead of
+ * sending them in bursts, and keeps the UART free for event frames.
+ *
+ * @tparam N The maximum number of scheduled frames, no larger than 255.
+ * @tparam SerialCANT The SerialCAN type the frames are sent through.
+ */
+template<size_t N, typename SerialCANT = SerialCAN>
+class CyclicScheduler {
+    static_assert(N > 0 && N < 256, "CyclicScheduler capacity must be between 1 and 255");
+
+ public:
+    /**
+     * Type of the scheduled frames.
+     */
+    typedef typename SerialCANT::FrameT FrameT;
+
+    /**
+     * Type of the update callback, called right before a frame is sent, e.g. to encode the
+     * latest signal values into the payload.
+     */
+    typedef void (*UpdateHandler)(FrameT *frame);
+
+    /**
+     * Constructor for CyclicScheduler class.
+     * @param serial_can The SerialCAN object to send the frames through.
+     * @param phase_step_us Resolution of automatically assigned phases, in microseconds.
+     *                      About the time one frame takes on the UART works well.
+     */
+    explicit CyclicScheduler(SerialCANT *serial_can, uint32_t phase_step_us = 500) :
+        _serial_can{serial_can}, _phase_step_us{phase_step_us > 0 ? phase_step_us : 1} {}
+
+    /**
+     * Registers a frame with the phase that collides least with the frames already
+     * scheduled.
+     * @param frame The frame, which must outlive the scheduler. It is sent in place.
+     * @param period_us The period in microseconds.
+     * @param update Optional callback called right before each transmission.
+     * @return True if the frame was registered, false if the schedule is full.
+     */
+    bool add(FrameT *frame, uint32_t period_us, UpdateHandler update = nullptr) {
+        return addWithPhase(frame, period_us, leastCollidingPhase_(period_us), update);
+    }
+
+    /**
+     * Registers a frame with the given phase.
+     * @param frame The frame, which must outlive the scheduler. It is sent in place.
+     * @param period_us The period in microseconds.
+     * @param phase_us The offset of the first transmission from the first tick().
+     * @param update Optional callback called right before each transmission.
+     * @return True if the frame was registered, false if the schedule is full.
+     */
+    bool addWithPhase(FrameT *frame, uint32_t period_us, uint32_t phase_us,
+        UpdateHandler update = nullptr) {
+        if (_count == N || period_us == 0) {
+            return false;
+        }
+
+        Entry &entry = _entries[_count++];
+        entry.frame = frame;
+        entry.update = update;
+        entry.period_us = period_us;
+        entry.phase_us = phase_us % period_us;
+        entry.statistics = CyclicStatistics{};
+
+        // Frames added while running join the schedule at their next release
+        if (_started) {
+            uint32_t elapsed_us = _last_tick_us - _start_us;
+            uint32_t periods = elapsed_us >= entry.phase_us ?
+                (elapsed_us - entry.phase_us) / period_us + 1 : 0;
+            entry.due_us = _start_us + entry.phase_us + periods * period_us;
+        }
+        return true;
+    }
+
+    /**
+     * Sends the frames that are due, the most overdue first.
+     * The first call starts the schedule.
+     * @param now_us The current time in microseconds, e.g. micros(). The sent frames are
+     *               timestamped with it in milliseconds, like the rest of the library.
+     * @param max_frames The maximum number of frames to send.
+     * @return The number of frames sent.
+     */
+    size_t tick(uint32_t now_us, size_t max_frames = N) {
+        if (!_started) {
+            start_(now_us);
+        }
+        _last_tick_us = now_us;
+
+        size_t n_frames = 0;
+        while (n_frames < max_frames) {
+            Entry *entry = mostOverdue_(now_us);
+            if (entry == nullptr) {
+                break;
+            }
+
+            if (entry->update != nullptr) {
+                entry->update(entry->frame);
+            }
+            _serial_can->send(entry->frame, now_us / 1000);
+            n_frames++;
+
+            // Releases that passed while the frame was waiting are missed
+            uint32_t jitter_us = now_us - entry->due_us;
+            uint32_t missed = jitter_us / entry->period_us;
+            CyclicStatistics &statistics = entry->statistics;
+            statistics.sent_frames++;
+            statistics.missed_deadlines += missed;
+            statistics.last_jitter_us = jitter_us;
+            if (jitter_us > statistics.max_jitter_us) {
+                statistics.max_jitter_us = jitter_us;
+            }
+            entry->due_us += (missed + 1) * entry->period_us;
+        }
+
+        return n_frames;
+    }
+
+    /**
+     * Get the time until the next frame is due, e.g. to sleep until then.
+     * @param now_us The current time in microseconds.
+     * @return The time in microseconds, 0 if a frame is due.
+     */
+    uint32_t timeUntilNext(uint32_t now_us) const {
+        if (!_started) {
+            return 0;
+        }
+
+        uint32_t wait_us = 0xFFFFFFFF;
+        for (size_t i = 0; i < _count; i++) {
+            int32_t remaining_us = static_cast<int32_t>(_entries[i].due_us - now_us);
+            if (remaining_us <= 0) {
+                return 0;
+            }
+            if (static_cast<uint32_t>(remaining_us) < wait_us) {
+                wait_us = remaining_us;
+            }
+        }
+        return wait_us;
+    }
+
+    /**
+     * Get the phase of a scheduled frame.
+     * @param index The index of the frame, in the order of registration.
+     * @return The phase in microseconds.
+     */
+    uint32_t getPhase(size_t index) const { return _entries[index].phase_us; }
+
+    /**
+     * Get the transmit statistics of a scheduled frame.
+     * @param index The index of the frame, in the order of registration.
+     * @return The statistics.
+     */
+    const CyclicStatistics &getStatistics(size_t index) const {
+        return _entries[index].statistics;
+    }
+
+    /**
+     * Resets the transmit statistics of all frames.
+     */
+    void resetStatistics() {
+        for (size_t i = 0; i < _count; i++) {
+            _entries[i].statistics = CyclicStatistics{};
+        }
+    }
+
+    /**
+     * Get the number of scheduled frames.
+     * @return The number of frames.
+     */
+    size_t size() const { return _count; }
+
+    /**
+     * Get the capacity of the schedule.
+     * @return The maximum number of frames.
+     */
+    static constexpr size_t capacity() { return N; }
+
+ private:
+    /**
+     * Scheduled frame.
+     */
+    struct Entry {
+        FrameT *frame;                  /**< The frame, sent in place. */
+        UpdateHandler update;           /**< Called before each transmission, or nullptr. */
+        uint32_t period_us;             /**< The period. */
+        uint32_t phase_us;              /**< Offset of the releases from the schedule start. */
+        uint32_t due_us;                /**< Time of the next release. */
+        CyclicStatistics statistics;    /**< Transmit statistics. */
+    };
+
+    /**
+     * Sets the release times of all frames relative to the first tick.
+     * @param now_us The time of the first tick.
+     */
+    void start_(uint32_t now_us) {
+        _start_us = now_us;
+        for (size_t i = 0; i < _count; i++) {
+            _entries[i].due_us = now_us + _entries[i].phase_us;
+        }
+        _started = true;
+    }
+
+    /**
+     * Finds the frame that has been due the longest.
+     * @param now_us The current time.
+     * @return The frame, or nullptr if no frame is due.
+     */
+    Entry *mostOverdue_(uint32_t now_us) {
+        Entry *overdue = nullptr;
+        uint32_t max_late_us = 0;
+
+        for (size_t i = 0; i < _count; i++) {
+            int32_t late_us = static_cast<int32_t>(now_us - _entries[i].due_us);
+            if (late_us >= 0 &&
+                (overdue == nullptr || static_cast<uint32_t>(late_us) > max_late_us)) {
+                overdue = &_entries[i];
+                max_late_us = late_us;
+            }
+        }
+        return overdue;
+    }
+
+    /**
+     * Finds the phase for a new frame whose releases are furthest from the releases of the
+     * scheduled frames. Two frames with periods P1 and P2 are released at the same time
+     * whenever their phases are equal modulo gcd(P1, P2), so the distance between their
+     * releases only depends on the phase difference modulo the gcd.
+     * @param period_us The period of the new frame.
+     * @return The phase in microseconds, a multiple of the phase step.
+     */
+    uint32_t leastCollidingPhase_(uint32_t period_us) const {
+        if (_count == 0 || period_us == 0) {
+            return 0;
+        }
+
+        // Limit the number of candidates for long periods
+        uint32_t step_us = _phase_step_us;
+        while (period_us / step_us > max_phase_candidates_) {
+            step_us *= 2;
+        }
+
+        uint32_t best_phase_us = 0;
+        uint32_t best_distance_us = 0;
+        for (uint32_t phase_us = 0; phase_us < period_us; phase_us += step_us) {
+            uint32_t distance_us = 0xFFFFFFFF;
+            for (size_t i = 0; i < _count && distance_us > best_distance_us; i++) {
+                uint32_t gcd_us = gcd_(period_us, _entries[i].period_us);
+                uint32_t offset_us = (phase_us + gcd_us - _entries[i].phase_us % gcd_us) % gcd_us;
+                uint32_t circular_us = offset_us < gcd_us - offset_us ?
+                    offset_us : gcd_us - offset_us;
+                if (circular_us < distance_us) {
+                    distance_us = circular_us;
+                }
+            }
+
+            if (distance_us > best_distance_us) {
+                best_distance_us = distance_us;
+                best_phase_us = phase_us;
+            }
+        }
+        return best_phase_us;
+    }
+
+    /**
+     * Greatest common divisor.
+     */
+    static uint32_t gcd_(uint32_t a, uint32_t b) {
+        while (b != 0) {
+            uint32_t remainder = a % b;
+            a = b;
+            b = remainder;
+        }
+        return a;
+    }
+
+    static const uint32_t max_phase_candidates_ = 256;
+
+    SerialCANT *_serial_can;        /**< Pointer to the SerialCAN object. */
+    uint32_t _phase_step_us;        /**< Resolution of automatically assigned phases. */
+    Entry _entries[N];              /**< The schedule, in the order of registration. */
+    size_t _count = 0;              /**< Number of scheduled frames. */
+    bool _started = false;          /**< Whether tick() has been called. */
+    uint32_t _start_us = 0;         /**< Time of the first tick. */
+    uint32_t _last_tick_us = 0;     /**< Time of the last tick. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_CYCLICSCHEDULER_HPP_
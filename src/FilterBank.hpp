@@ -0,0 +1,127 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_FILTERBANK_HPP_
+#define SERIALCAN_SRC_FILTERBANK_HPP_
+
+#include "Utils.hpp"
+
+namespace serial_can {
+
+/**
+ * Mask/ID acceptance filter, like the filter banks of CAN controllers.
+ * A frame matches if (arbitration_id & mask) == (id & mask).
+ */
+struct MaskFilter {
+    uint32_t id;    /**< The arbitration ID to match. */
+    uint32_t mask;  /**< The ID bits that have to match. */
+};
+
+/**
+ * Acceptance filter bank evaluated on the arbitration ID of incoming frames.
+ * A frame is accepted if it matches any of the mask filters or any of the exact IDs.
+ * If no filters are configured, all frames are accepted.
+ * The filter arrays are referenced, not copied, and must outlive the filter bank.
+ */
+class FilterBank {
+ public:
+    /**
+     * Sets the mask/ID filter pairs.
+     * @param filters Array of mask filters.
+     * @param n_filters The number of filters in the array.
+     */
+    void setMaskFilters(const MaskFilter *filters, size_t n_filters) {
+        _mask_filters = filters;
+        _n_mask_filters = filters != nullptr ? n_filters : 0;
+    }
+
+    /**
+     * Sets the list of exactly matched IDs, which is searched with binary search.
+     * @param sorted_ids Array of arbitration IDs.
+     * @param n_ids The number of IDs in the array.
+     * @pre The IDs are sorted in ascending order.
+     */
+    void setExactIds(const uint32_t *sorted_ids, size_t n_ids) {
+        _exact_ids = sorted_ids;
+        _n_exact_ids = sorted_ids != nullptr ? n_ids : 0;
+    }
+
+    /**
+     * Removes all filters, so that all frames are accepted.
+     */
+    void clear() {
+        setMaskFilters(nullptr, 0);
+        setExactIds(nullptr, 0);
+    }
+
+    /**
+     * Checks if any filter is configured.
+     * @return True if frames are filtered.
+     */
+    bool enabled() const { return _n_mask_filters > 0 || _n_exact_ids > 0; }
+
+    /**
+     * Checks if a frame with the given arbitration ID passes the filter bank.
+     * @param id The arbitration ID.
+     * @return True if the frame is accepted.
+     */
+    bool accepts(uint32_t id) const {
+        if (!enabled()) {
+            return true;
+        }
+
+        for (size_t i = 0; i < _n_mask_filters; i++) {
+            if (((id ^ _mask_filters[i].id) & _mask_filters[i].mask) == 0) {
+                return true;
+            }
+        }
+
+        size_t low = 0;
+        size_t high = _n_exact_ids;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (_exact_ids[middle] < id) {
+                low = middle + 1;
+            } else if (_exact_ids[middle] > id) {
+                high = middle;
+            } else {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+ private:
+    const MaskFilter *_mask_filters = nullptr;  /**< Mask/ID filter pairs. */
+    size_t _n_mask_filters = 0;                 /**< Number of mask/ID filter pairs. */
+    const uint32_t *_exact_ids = nullptr;       /**< Sorted exactly matched IDs. */
+    size_t _n_exact_ids = 0;                    /**< Number of exactly matched IDs. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_FILTERBANK_HPP_
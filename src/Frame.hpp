@@ -31,17 +31,50 @@
 
 #include <assert.h>
 #include <string.h>
-#include "Arduino.h"
 #include "Utils.hpp"
 
 namespace serial_can {
 
-constexpr size_t MAX_DLC = 8;
+constexpr size_t MAX_DLC = 8;      /**< Maximum payload size of a classic CAN frame. */
+constexpr size_t MAX_FD_DLC = 64;  /**< Maximum payload size of a CAN FD frame. */
 
 /**
- * Represents a CAN frame for communication over a Serial bus.
+ * Whether values of a type can be packed into a payload by the variadic
+ * BasicFrame::encode() and decode(), which holds for integer, floating point and enum
+ * types. Uses the __is_enum() compiler builtin, as <type_traits> is not available on AVR.
+ *
+ * @tparam T The type of the values.
+ */
+template<typename T>
+struct IsPackable {
+    static constexpr bool value = __is_enum(T);
+};
+
+#define SERIALCAN_PACKABLE(T) \
+    template<> struct IsPackable<T> { static constexpr bool value = true; }
+
+SERIALCAN_PACKABLE(bool);
+SERIALCAN_PACKABLE(char);
+SERIALCAN_PACKABLE(signed char);
+SERIALCAN_PACKABLE(unsigned char);
+SERIALCAN_PACKABLE(short);
+SERIALCAN_PACKABLE(unsigned short);
+SERIALCAN_PACKABLE(int);
+SERIALCAN_PACKABLE(unsigned int);
+SERIALCAN_PACKABLE(long);
+SERIALCAN_PACKABLE(unsigned long);
+SERIALCAN_PACKABLE(long long);
+SERIALCAN_PACKABLE(unsigned long long);
+SERIALCAN_PACKABLE(float);
+SERIALCAN_PACKABLE(double);
+SERIALCAN_PACKABLE(long double);
+
+#undef SERIALCAN_PACKABLE
+
+/**
+ * Frame settings shared by all frame capacities.
  */
-class Frame {
+class FrameBase {
  public:
     /**
      * CRC checksum settings.
@@ -51,19 +84,72 @@ class Frame {
         crc8                /**< Use CRC8 as checksum */
     };
 
+    /**
+     * CAN frame flags, carried in the upper bits of the serial DLC byte.
+     */
+    enum frame_flags {
+        fd_frame = 0x80,          /**< CAN FD frame, payload sizes up to 64 bytes. */
+        bitrate_switch = 0x40     /**< CAN FD bit rate switch (BRS). */
+    };
+
+    /**
+     * Converts a CAN DLC code to the payload size in bytes.
+     * Codes 9 to 15 map to the CAN FD sizes 12, 16, 20, 24, 32, 48 and 64.
+     * @param dlc_code The DLC code, 0 to 15.
+     * @return The payload size in bytes.
+     */
+    static uint8_t dlcToLength(uint8_t dlc_code) {
+        if (dlc_code <= 8) {
+            return dlc_code;
+        }
+        if (dlc_code <= 12) {
+            return 8 + (dlc_code - 8) * 4;
+        }
+        return dlc_code == 13 ? 32 : (dlc_code == 14 ? 48 : 64);
+    }
+
+    /**
+     * Converts a payload size in bytes to the smallest CAN DLC code that can carry it.
+     * @param length The payload size in bytes, maximum 64.
+     * @return The DLC code, 0 to 15.
+     */
+    static uint8_t lengthToDlc(uint8_t length) {
+        if (length <= 8) {
+            return length;
+        }
+        if (length <= 24) {
+            return 8 + (length - 5) / 4;
+        }
+        return length <= 32 ? 13 : (length <= 48 ? 14 : 15);
+    }
+};
+
+/**
+ * Represents a CAN frame for communication over a Serial bus.
+ *
+ * @tparam Capacity The payload capacity in bytes, MAX_DLC for classic CAN frames or
+ *                  MAX_FD_DLC for CAN FD frames.
+ */
+template<size_t Capacity>
+class BasicFrame : public FrameBase {
+    static_assert(Capacity >= MAX_DLC && Capacity <= MAX_FD_DLC,
+        "Frame capacity must be between 8 and 64 bytes");
+
+ public:
     /**
      * CAN frame arbitration/message ID.
      */
     uint32_t arbitration_id;
 
     /**
-     * CAN frame DLC (payload size in bytes, maximum 8).
+     * CAN frame DLC (payload size in bytes, maximum 8, or 64 for CAN FD frames).
+     * CAN FD payload sizes above 8 bytes are rounded up to the next valid size when sent.
      */
     uint8_t dlc;
 
     /**
      * Indicates whether to activate CRC calculations for end-to-end protection.
-     * Warning: Using CRC will limit the effective payload size to max 6 bytes.
+     * Warning: Using CRC will reduce the effective payload size by 2 bytes.
      */
     crc_settings use_crc;
 
@@ -75,7 +161,7 @@ class Frame {
     /**
      * Stored CAN frame payload.
      */
-    uint8_t payload[MAX_DLC] = {};
+    uint8_t payload[Capacity] = {};
 
     /**
      * Counter used for CRC calculations.
@@ -87,17 +173,22 @@ class Frame {
      */
     uint8_t crc = {};
 
+    /**
+     * CAN frame flags, see frame_flags.
+     */
+    uint8_t flags = {};
+
     /**
      * Constructs a new Frame object.
      */
-    Frame() : arbitration_id{0x00}, dlc{MAX_DLC}, use_crc{crc_settings::no_crc} {}
+    BasicFrame() : arbitration_id{0x00}, dlc{MAX_DLC}, use_crc{crc_settings::no_crc} {}
 
     /**
      * Constructs a new Frame object.
      *
      * @param _use_crc Enum indicating whether to use CRC calculations.
      */
-    explicit Frame(crc_settings _use_crc) :
+    explicit BasicFrame(crc_settings _use_crc) :
         arbitration_id{0x00}, dlc{MAX_DLC}, use_crc{_use_crc} {}
 
      /**
@@ -105,12 +196,12 @@ class Frame {
      *
      * @param _arbitration_id The CAN frame arbitration ID.
      * @param _dlc The CAN frame DLC.
-     * @pre The maximum allowed DLC is 8.
+     * @pre The maximum allowed DLC is the frame capacity.
      */
-    Frame(uint32_t _arbitration_id, uint8_t _dlc) :
+    BasicFrame(uint32_t _arbitration_id, uint8_t _dlc) :
       arbitration_id{_arbitration_id}, dlc{_dlc}, use_crc{crc_settings::no_crc} {
-        // Maximum allowed DLC is 8.
-        assert(dlc <= MAX_DLC);
+        // Maximum allowed DLC is the frame capacity.
+        assert(dlc <= Capacity);
     }
 
     /**
@@ -119,31 +210,52 @@ class Frame {
      * @param _arbitration_id The CAN frame arbitration ID.
      * @param _dlc The CAN frame DLC.
      * @param _use_crc Enum indicating whether to use CRC calculations.
-     * @pre The maximum allowed DLC is 8.
+     * @pre The maximum allowed DLC is the frame capacity.
      */
-    Frame(uint32_t _arbitration_id, uint8_t _dlc, crc_settings _use_crc) :
+    BasicFrame(uint32_t _arbitration_id, uint8_t _dlc, crc_settings _use_crc) :
       arbitration_id{_arbitration_id}, dlc{_dlc}, use_crc{_use_crc} {
-        // Maximum allowed DLC is 8.
-        assert(dlc <= MAX_DLC);
+        // Maximum allowed DLC is the frame capacity.
+        assert(dlc <= Capacity);
+    }
+
+    /**
+     * Constructs a new Frame object.
+     *
+     * @param _arbitration_id The CAN frame arbitration ID.
+     * @param _dlc The CAN frame DLC.
+     * @param _use_crc Enum indicating whether to use CRC calculations.
+     * @param _flags The CAN frame flags, e.g. fd_frame | bitrate_switch.
+     * @pre The maximum allowed DLC is the frame capacity.
+     */
+    BasicFrame(uint32_t _arbitration_id, uint8_t _dlc, crc_settings _use_crc, uint8_t _flags) :
+      arbitration_id{_arbitration_id}, dlc{_dlc}, use_crc{_use_crc}, flags{_flags} {
+        // Maximum allowed DLC is the frame capacity.
+        assert(dlc <= Capacity);
     }
 
+    /**
+     * Get the payload capacity of the frame type.
+     * @return The payload capacity in bytes.
+     */
+    static constexpr size_t capacity() { return Capacity; }
+
     /**
      * Encodes and packs the given data into the payload using the specified initializer list.
-     * The size of each data element must not exceed 6 bytes if CRC is enabled, or 8 bytes otherwise.
+     * The total size must not exceed the capacity, minus 2 bytes if CRC is enabled.
      *
      * @param data_list The initializer list of data elements to encode and pack.
      * @tparam T The type of data elements.
-     * @pre The maximum allowed number of bytes is 6 when use_crc is crc8.
-     * @pre The maximum allowed number of bytes is 8 when use_crc is no_crc.
+     * @pre The maximum allowed number of bytes is 6 (62 for CAN FD) when use_crc is crc8.
+     * @pre The maximum allowed number of bytes is 8 (64 for CAN FD) when use_crc is no_crc.
      */
     template<typename T>
     void encode(std::initializer_list<T> data_list) {
         const size_t T_size = sizeof(T);
 
-        // Maximum allowed number of bytes is 6 if use_crc is crc8
-        assert((use_crc && data_list.size() * T_size <= 6) || !use_crc);
-        // Maximum allowed number of bytes is 8 if use_crc is no_crc
-        assert(data_list.size() * T_size <= MAX_DLC);
+        // Maximum allowed number of bytes is the capacity minus 2 if use_crc is crc8
+        assert((use_crc && data_list.size() * T_size <= Capacity - 2) || !use_crc);
+        // Maximum allowed number of bytes is the capacity if use_crc is no_crc
+        assert(data_list.size() * T_size <= Capacity);
 
         // Clear the payload before populating with new data
         clearPayload_();
@@ -157,19 +269,19 @@ class Frame {
 
     /**
      * Encodes and packs the given string into the payload.
-     * The length of the string must not exceed 6 bytes if CRC is enabled, or 8 bytes otherwise.
+     * The length must not exceed the capacity, minus 2 bytes if CRC is enabled.
      *
      * @param string The string to encode and pack.
-     * @pre The maximum allowed number of bytes is 6 when use_crc is crc8.
-     * @pre The maximum allowed number of bytes is 8 when use_crc is no_crc.
+     * @pre The maximum allowed number of bytes is 6 (62 for CAN FD) when use_crc is crc8.
+     * @pre The maximum allowed number of bytes is 8 (64 for CAN FD) when use_crc is no_crc.
      */
     void encode(const char* string) {
         size_t string_len = strlen(string);
 
-        // Maximum allowed number of bytes is 6 if use_crc is crc8
-        assert((use_crc && string_len <= 6) || !use_crc);
-        // Maximum allowed number of bytes is 8 if use_crc is no_crc
-        assert(string_len <= MAX_DLC);
+        // Maximum allowed number of bytes is the capacity minus 2 if use_crc is crc8
+        assert((use_crc && string_len <= Capacity - 2) || !use_crc);
+        // Maximum allowed number of bytes is the capacity if use_crc is no_crc
+        assert(string_len <= Capacity);
 
         // Clear the payload before populating with new data
         clearPayload_();
@@ -179,6 +291,62 @@ class Frame {
             packData_<char>(string[i], current_start_byte++);
     }
 
+    /**
+     * Encodes and packs the given string into the payload, see encode(const char*).
+     * Keeps mutable strings and char arrays from being packed by the variadic encode().
+     *
+     * @param string The string to encode and pack.
+     */
+    void encode(char* string) { encode(static_cast<const char*>(string)); }
+
+    /**
+     * Encodes and packs the given values of any types into the payload, one after the
+     * other in little-endian byte order, e.g. encode(uint16_t{1500}, uint8_t{90}, 0.5f).
+     * The total size is checked against the capacity at compile time. Bytes after the
+     * values are cleared.
+     *
+     * @param values The values to encode and pack.
+     * @tparam Ts The types of the values, integers, enums or floating point types.
+     * @pre The total size does not exceed the capacity minus 2 bytes when use_crc is crc8.
+     */
+    template<typename... Ts>
+    void encode(const Ts&... values) {
+        static_assert(Size_<Ts...>::value <= Capacity,
+            "Encoded values do not fit into the frame payload");
+        // Maximum allowed number of bytes is the capacity minus 2 if use_crc is crc8
+        assert(!use_crc || Size_<Ts...>::value <= Capacity - 2);
+
+        uint8_t *position = payload;
+        int expand[] = {0, (position = storeLittleEndian_(position, values), 0)...};
+        static_cast<void>(expand);
+
+        // Only the bytes that were not written are cleared
+        memset(position, 0, Capacity - Size_<Ts...>::value);
+    }
+
+    /**
+     * Decodes values of any types from the payload, in the layout written by the variadic
+     * encode().
+     *
+     * @param values Set to the decoded values.
+     * @tparam Ts The types of the values.
+     * @return True if the values were decoded, false if the DLC is smaller than their size.
+     */
+    template<typename... Ts>
+    bool decode(Ts&... values) const {
+        static_assert(Size_<Ts...>::value <= Capacity,
+            "Decoded values do not fit into the frame payload");
+
+        if (dlc < Size_<Ts...>::value) {
+            return false;
+        }
+
+        const uint8_t *position = payload;
+        int expand[] = {0, (position = loadLittleEndian_(position, &values), 0)...};
+        static_cast<void>(expand);
+        return true;
+    }
+
  private:
     /**
      * Packs the given data into the payload starting from the specified byte index.
@@ -189,20 +357,89 @@ class Frame {
      */
     template<typename T>
     void packData_(T data, int start_byte) {
-        for (int i = 0; i < sizeof(data); i++) {
+        for (size_t i = 0; i < sizeof(data); i++) {
             payload[i+start_byte] = data >> (i * 8);
         }
     }
 
+    /**
+     * Total size of a list of types in bytes.
+     */
+    template<typename... Ts>
+    struct Size_ {
+        static constexpr size_t value = 0;
+    };
+
+    template<typename T, typename... Rest>
+    struct Size_<T, Rest...> {
+        static constexpr size_t value = sizeof(T) + Size_<Rest...>::value;
+    };
+
+    /**
+     * Stores a value in little-endian byte order.
+     *
+     * @param destination Where to store the value.
+     * @param value The value.
+     * @return The position after the value.
+     */
+    template<typename T>
+    static uint8_t *storeLittleEndian_(uint8_t *destination, const T& value) {
+        static_assert(IsPackable<T>::value,
+            "Only integer, floating point and enum values can be encoded");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(destination, &value, sizeof(T));
+#else
+        uint8_t bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        for (size_t i = 0; i < sizeof(T); i++) {
+            destination[i] = bytes[sizeof(T) - 1 - i];
+        }
+#endif
+        return destination + sizeof(T);
+    }
+
+    /**
+     * Loads a value stored in little-endian byte order.
+     *
+     * @param source Where the value is stored.
+     * @param value Set to the value.
+     * @return The position after the value.
+     */
+    template<typename T>
+    static const uint8_t *loadLittleEndian_(const uint8_t *source, T *value) {
+        static_assert(IsPackable<T>::value,
+            "Only integer, floating point and enum values can be decoded");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(value, source, sizeof(T));
+#else
+        uint8_t bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bytes[sizeof(T) - 1 - i] = source[i];
+        }
+        memcpy(value, bytes, sizeof(T));
+#endif
+        return source + sizeof(T);
+    }
+
     /**
      * Clears the payload data and sets all elements to zero.
      */
     void clearPayload_() {
-        for (int i = 0; i < MAX_DLC; i++)
+        for (size_t i = 0; i < Capacity; i++)
             payload[i] = 0;
     }
 };
 
+/**
+ * Classic CAN frame with up to 8 bytes of payload.
+ */
+using Frame = BasicFrame<MAX_DLC>;
+
+/**
+ * CAN FD frame with up to 64 bytes of payload.
+ */
+using FDFrame = BasicFrame<MAX_FD_DLC>;
+
 }  // namespace serial_can
 
 #endif  // SERIALCAN_SRC_FRAME_HPP_
@@ -0,0 +1,210 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_FRAMEDISPATCHER_HPP_
+#define SERIALCAN_SRC_FRAMEDISPATCHER_HPP_
+
+#include "Utils.hpp"
+#include "Frame.hpp"
+
+namespace serial_can {
+
+/**
+ * Table of frame handlers looked up by arbitration ID.
+ * Handlers for single IDs are kept sorted and found with binary search, handlers for
+ * ID ranges (mask/ID pairs) are checked in registration order if no single ID matches.
+ * The storage is provided by StaticFrameDispatcher, so no heap memory is used.
+ *
+ * @tparam FrameT The type of the dispatched frames.
+ */
+template<typename FrameT>
+class BasicFrameDispatcher {
+ public:
+    /**
+     * Callback for received CAN frames.
+     */
+    typedef void (*Handler)(FrameT *frame);
+
+    /**
+     * Handler registered for a single arbitration ID.
+     */
+    struct IdHandler {
+        uint32_t id;           /**< The arbitration ID. */
+        Handler handler;       /**< The handler called for the ID. */
+    };
+
+    /**
+     * Handler registered for all arbitration IDs matching a mask/ID pair.
+     */
+    struct RangeHandler {
+        uint32_t id;           /**< The arbitration ID to match. */
+        uint32_t mask;         /**< The ID bits that have to match. */
+        Handler handler;       /**< The handler called for matching IDs. */
+    };
+
+    /**
+     * Registers a handler for a single arbitration ID, replacing any earlier handler
+     * for the same ID.
+     * @param id The arbitration ID.
+     * @param handler The handler to be called for frames with the ID.
+     * @return True if the handler was registered, false if the table is full.
+     */
+    bool onFrame(uint32_t id, Handler handler) {
+        size_t position = lowerBound_(id);
+
+        if (position < _n_ids && _ids[position].id == id) {
+            _ids[position].handler = handler;
+            return true;
+        }
+
+        if (_n_ids == _max_ids) {
+            return false;
+        }
+
+        for (size_t i = _n_ids; i > position; i--) {
+            _ids[i] = _ids[i-1];
+        }
+        _ids[position] = {id, handler};
+        _n_ids++;
+        return true;
+    }
+
+    /**
+     * Registers a handler for all arbitration IDs where (arbitration_id & mask) == (id & mask).
+     * @param mask The ID bits that have to match.
+     * @param id The arbitration ID to match.
+     * @param handler The handler to be called for matching frames.
+     * @return True if the handler was registered, false if the table is full.
+     */
+    bool onFrameRange(uint32_t mask, uint32_t id, Handler handler) {
+        if (_n_ranges == _max_ranges) {
+            return false;
+        }
+        _ranges[_n_ranges++] = {id, mask, handler};
+        return true;
+    }
+
+    /**
+     * Finds the handler for an arbitration ID.
+     * @param id The arbitration ID.
+     * @return The handler, or nullptr if no handler matches.
+     */
+    Handler find(uint32_t id) const {
+        size_t position = lowerBound_(id);
+        if (position < _n_ids && _ids[position].id == id) {
+            return _ids[position].handler;
+        }
+
+        for (size_t i = 0; i < _n_ranges; i++) {
+            if (((id ^ _ranges[i].id) & _ranges[i].mask) == 0) {
+                return _ranges[i].handler;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Calls the handler registered for the frame's arbitration ID.
+     * @param frame The received CAN frame.
+     * @return True if a handler was called.
+     */
+    bool dispatch(FrameT *frame) const {
+        Handler handler = find(frame->arbitration_id);
+        if (handler == nullptr) {
+            return false;
+        }
+        handler(frame);
+        return true;
+    }
+
+ protected:
+    /**
+     * Constructor for BasicFrameDispatcher class.
+     * @param ids Storage for single ID handlers.
+     * @param max_ids The number of single ID handlers the storage can hold.
+     * @param ranges Storage for ID range handlers.
+     * @param max_ranges The number of ID range handlers the storage can hold.
+     */
+    BasicFrameDispatcher(IdHandler *ids, size_t max_ids, RangeHandler *ranges,
+        size_t max_ranges) :
+        _ids{ids}, _max_ids{max_ids}, _ranges{ranges}, _max_ranges{max_ranges} {}
+
+ private:
+    /**
+     * Finds the first single ID handler whose ID is not lower than id.
+     * @param id The arbitration ID to search for.
+     * @return The position in the single ID handler table.
+     */
+    size_t lowerBound_(uint32_t id) const {
+        size_t low = 0;
+        size_t high = _n_ids;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (_ids[middle].id < id) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    IdHandler *_ids;          /**< Single ID handlers sorted by ID. */
+    size_t _max_ids;          /**< Capacity of the single ID handler table. */
+    size_t _n_ids = 0;        /**< Number of single ID handlers. */
+    RangeHandler *_ranges;    /**< ID range handlers in registration order. */
+    size_t _max_ranges;       /**< Capacity of the ID range handler table. */
+    size_t _n_ranges = 0;     /**< Number of ID range handlers. */
+};
+
+/**
+ * Frame handler table for classic CAN frames.
+ */
+using FrameDispatcher = BasicFrameDispatcher<Frame>;
+
+/**
+ * Frame handler table with statically allocated storage.
+ *
+ * @tparam MaxIds The maximum number of single ID handlers.
+ * @tparam MaxRanges The maximum number of ID range handlers.
+ * @tparam FrameT The type of the dispatched frames.
+ */
+template<size_t MaxIds, size_t MaxRanges = 4, typename FrameT = Frame>
+class StaticFrameDispatcher : public BasicFrameDispatcher<FrameT> {
+    typedef BasicFrameDispatcher<FrameT> Base;
+
+ public:
+    StaticFrameDispatcher() : Base(_id_storage, MaxIds, _range_storage, MaxRanges) {}
+
+ private:
+    typename Base::IdHandler _id_storage[MaxIds];           /**< Single ID handler storage. */
+    typename Base::RangeHandler _range_storage[MaxRanges];  /**< ID range handler storage. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_FRAMEDISPATCHER_HPP_
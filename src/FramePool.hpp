@@ -0,0 +1,133 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_FRAMEPOOL_HPP_
+#define SERIALCAN_SRC_FRAMEPOOL_HPP_
+
+#include "Utils.hpp"
+#include "Frame.hpp"
+
+namespace serial_can {
+
+/**
+ * Handle of a frame in a FramePool. Handles are a single byte, so they are cheap to pass
+ * between queues, e.g. a FrameRingBuffer<N, FrameHandle>.
+ */
+typedef uint8_t FrameHandle;
+
+constexpr FrameHandle INVALID_FRAME_HANDLE = 0xFF;  /**< Handle returned by an empty pool. */
+
+/**
+ * Statically sized pool of CAN frames. Frames are acquired and released in O(1) through a
+ * free list, and referred to by handles instead of being copied, so that a frame can move
+ * from the receive queue through dispatch to the transmit queue without heap usage or
+ * per-frame copies.
+ *
+ * The free list links are kept in one byte per frame next to the frames, so that frames
+ * are returned with all their fields intact, including the E2E counter. The pool is not
+ * safe to use from an interrupt and the main loop at the same time.
+ *
+ * @tparam N The capacity in frames, no larger than 255.
+ * @tparam FrameT The type of the pooled frames.
+ */
+template<size_t N, typename FrameT = Frame>
+class FramePool {
+    static_assert(N > 0 && N < INVALID_FRAME_HANDLE,
+        "FramePool capacity must be between 1 and 254 frames");
+
+ public:
+    FramePool() {
+        for (size_t i = 0; i < N; i++) {
+            _next[i] = i + 1 < N ? static_cast<FrameHandle>(i + 1) : INVALID_FRAME_HANDLE;
+        }
+    }
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    /**
+     * Takes a frame out of the pool. The frame keeps the contents it was released with.
+     * @return The handle of the frame, or INVALID_FRAME_HANDLE if the pool is empty.
+     */
+    FrameHandle acquire() {
+        FrameHandle handle = _free;
+        if (handle != INVALID_FRAME_HANDLE) {
+            _free = _next[handle];
+            _available--;
+        }
+        return handle;
+    }
+
+    /**
+     * Returns a frame to the pool.
+     * @param handle The handle returned by acquire(). The frame must not be used afterwards.
+     */
+    void release(FrameHandle handle) {
+        assert(handle < N);
+        _next[handle] = _free;
+        _free = handle;
+        _available++;
+    }
+
+    /**
+     * Get a pooled frame.
+     * @param handle The handle returned by acquire().
+     * @return Pointer to the frame.
+     */
+    FrameT *get(FrameHandle handle) {
+        assert(handle < N);
+        return &_frames[handle];
+    }
+
+    /**
+     * Get a pooled frame.
+     * @param handle The handle returned by acquire().
+     * @return Pointer to the frame.
+     */
+    FrameT *operator[](FrameHandle handle) { return get(handle); }
+
+    /**
+     * Get the number of frames that can be acquired.
+     * @return The number of free frames.
+     */
+    size_t available() const { return _available; }
+
+    /**
+     * Get the capacity of the pool.
+     * @return The number of frames.
+     */
+    static constexpr size_t capacity() { return N; }
+
+ private:
+    FrameT _frames[N];                      /**< Frame storage. */
+    FrameHandle _next[N];                   /**< Next free frame of each free frame. */
+    FrameHandle _free = 0;                  /**< First free frame. */
+    uint8_t _available = N;                 /**< Number of free frames. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_FRAMEPOOL_HPP_
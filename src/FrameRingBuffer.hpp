@@ -0,0 +1,150 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_FRAMERINGBUFFER_HPP_
+#define SERIALCAN_SRC_FRAMERINGBUFFER_HPP_
+
+#include "Utils.hpp"
+#include "Frame.hpp"
+
+namespace serial_can {
+
+/**
+ * Fixed capacity, lock-free single-producer/single-consumer ring buffer of CAN frames.
+ * The producer (e.g. serialEvent() or a UART RX interrupt) fills slots in place with
+ * writeSlot() and commit(), while the main loop drains them with pop() without blocking.
+ *
+ * @tparam N The capacity in frames, a power of two no larger than 128.
+ * @tparam FrameT The type of the stored frames.
+ */
+template<size_t N, typename FrameT = Frame>
+class FrameRingBuffer {
+    static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0,
+        "FrameRingBuffer capacity must be a power of two no larger than 128");
+
+ public:
+    /**
+     * Returns the next free slot for the producer to populate in place.
+     * @return Pointer to the free slot, or nullptr if the ring buffer is full.
+     */
+    FrameT *writeSlot() {
+        if (full()) {
+            return nullptr;
+        }
+        return &_frames[_head & (N - 1)];
+    }
+
+    /**
+     * Publishes the slot returned by writeSlot() to the consumer.
+     */
+    void commit() {
+        SERIALCAN_MEMORY_BARRIER();
+        _head = _head + 1;
+    }
+
+    /**
+     * Copies a frame into the ring buffer.
+     * @param frame The frame to be pushed.
+     * @return True if the frame was pushed, false if the ring buffer is full.
+     */
+    bool push(const FrameT &frame) {
+        FrameT *slot = writeSlot();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = frame;
+        commit();
+        return true;
+    }
+
+    /**
+     * Returns the oldest frame for the consumer to read in place.
+     * @return Pointer to the oldest frame, or nullptr if the ring buffer is empty.
+     */
+    FrameT *readSlot() {
+        if (empty()) {
+            return nullptr;
+        }
+        SERIALCAN_MEMORY_BARRIER();
+        return &_frames[_tail & (N - 1)];
+    }
+
+    /**
+     * Hands the slot returned by readSlot() back to the producer.
+     */
+    void release() {
+        SERIALCAN_MEMORY_BARRIER();
+        _tail = _tail + 1;
+    }
+
+    /**
+     * Copies the oldest frame out of the ring buffer.
+     * @param frame The frame to be populated.
+     * @return True if a frame was popped, false if the ring buffer is empty.
+     */
+    bool pop(FrameT *frame) {
+        FrameT *slot = readSlot();
+        if (slot == nullptr) {
+            return false;
+        }
+        *frame = *slot;
+        release();
+        return true;
+    }
+
+    /**
+     * Get the number of frames in the ring buffer.
+     * @return The number of frames.
+     */
+    size_t size() const { return static_cast<uint8_t>(_head - _tail); }
+
+    /**
+     * Get the capacity of the ring buffer.
+     * @return The maximum number of frames.
+     */
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * Checks if the ring buffer is empty.
+     * @return True if there are no frames in the ring buffer.
+     */
+    bool empty() const { return _head == _tail; }
+
+    /**
+     * Checks if the ring buffer is full.
+     * @return True if there is no free slot in the ring buffer.
+     */
+    bool full() const { return size() == N; }
+
+ private:
+    FrameT _frames[N];             /**< Frame storage. */
+    volatile uint8_t _head = 0;    /**< Free running write index, owned by the producer. */
+    volatile uint8_t _tail = 0;    /**< Free running read index, owned by the consumer. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_FRAMERINGBUFFER_HPP_
@@ -0,0 +1,524 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_ISOTP_HPP_
+#define SERIALCAN_SRC_ISOTP_HPP_
+
+#include "SerialCAN.h"
+
+namespace serial_can {
+
+/**
+ * Settings and fault reasons shared by all ISO-TP channel types.
+ */
+class IsoTpBase {
+ public:
+    /**
+     * ISO-TP fault reasons.
+     */
+    enum iso_tp_fault {
+        none,                     /**< No fault */
+        tx_timeout,               /**< No flow control frame arrived in time (N_Bs) */
+        rx_timeout,               /**< No consecutive frame arrived in time (N_Cr) */
+        wrong_sequence,           /**< A consecutive frame had an unexpected sequence number */
+        buffer_overflow,          /**< The message does not fit the receiver's buffer */
+        receive_overrun           /**< A message arrived before the previous one was released */
+    };
+
+    /**
+     * Flow control status, sent in the low nibble of the flow control PCI byte.
+     */
+    enum flow_status {
+        continue_to_send = 0,     /**< Send the next block of consecutive frames */
+        wait = 1,                 /**< Restart the flow control timeout and keep waiting */
+        overflow = 2              /**< The message is too large, abort the transfer */
+    };
+
+    /**
+     * Timeout in microseconds for a flow control frame (N_Bs) or a consecutive frame (N_Cr).
+     */
+    static constexpr uint32_t timeout_us = 1000000;
+
+    /**
+     * Gets the last fault reason.
+     * @return The fault reason.
+     */
+    iso_tp_fault getFaultReason() const { return _fault_reason; }
+
+    /**
+     * Converts an STmin byte to microseconds. Reserved values map to the maximum, 127 ms.
+     * @param st_min The STmin byte, 0x00-0x7F in milliseconds or 0xF1-0xF9 in 100 us steps.
+     * @return The minimum separation time in microseconds.
+     */
+    static uint32_t stMinToMicros(uint8_t st_min) {
+        if (st_min <= 0x7F) {
+            return st_min * 1000UL;
+        }
+        if (st_min >= 0xF1 && st_min <= 0xF9) {
+            return (st_min - 0xF0) * 100UL;
+        }
+        return 127000UL;
+    }
+
+ protected:
+    iso_tp_fault _fault_reason = none;  /**< Last fault reason. */
+};
+
+/**
+ * ISO-TP (ISO 15765-2) transport channel that segments and reassembles messages of up
+ * to BufferSize bytes into single, first, consecutive and flow control frames.
+ *
+ * Both directions are non-blocking state machines: send() starts a transfer, incoming
+ * frames are fed with onFrame() and poll() paces consecutive frames and checks timeouts.
+ * All three take the current time, so timers always start from the time of the call.
+ * poll() sends one consecutive frame per call by default, so that a call never blocks for
+ * longer than one frame takes on the serial line. With block size 0 and STmin 0 a larger
+ * max_frames sends the consecutive frames back to back. Messages larger than 4095 bytes
+ * use the 32-bit first frame length escape, and CAN FD channels carry up to 62 bytes per
+ * frame.
+ *
+ * @tparam BufferSize The size of the reassembly buffer in bytes.
+ * @tparam SerialCANT The SerialCAN type the frames are sent through.
+ */
+template<size_t BufferSize, typename SerialCANT = SerialCAN>
+class IsoTpChannel : public IsoTpBase {
+    static_assert(BufferSize > 0, "IsoTpChannel buffer size must be at least 1 byte");
+
+ public:
+    /**
+     * Type of the sent and received frames.
+     */
+    typedef typename SerialCANT::FrameT FrameT;
+
+    /**
+     * Constructor for IsoTpChannel class.
+     * @param serial_can The SerialCAN object to send the frames through.
+     * @param tx_id The arbitration ID of the frames sent by this channel.
+     * @param rx_id The arbitration ID of the frames sent by the remote channel.
+     * @param block_size The number of consecutive frames the remote may send before waiting
+     *                   for the next flow control frame, 0 for no limit.
+     * @param st_min The minimum separation time the remote should keep between consecutive
+     *               frames, encoded as an STmin byte.
+     */
+    IsoTpChannel(SerialCANT *serial_can, uint32_t tx_id, uint32_t rx_id,
+        uint8_t block_size = 0, uint8_t st_min = 0) :
+        _serial_can{serial_can}, _rx_id{rx_id}, _tx_frame{tx_id, 0},
+        _block_size{block_size}, _st_min{st_min} {}
+
+    /**
+     * Starts sending a message. The data is not copied and must stay valid until
+     * sending() returns false.
+     * @param data The message.
+     * @param length The message length in bytes.
+     * @param now_us The current time in microseconds, e.g. micros().
+     * @return True if the transfer was started, false if a transfer is already in progress.
+     */
+    bool send(const uint8_t *data, size_t length, uint32_t now_us) {
+        if (_tx_state != tx_idle || length == 0) {
+            return false;
+        }
+
+        _now_us = now_us;
+
+        uint8_t *pci = _tx_frame.payload;
+        size_t header;
+
+        if (length <= 7) {
+            // Single frame
+            pci[0] = length;
+            header = 1;
+        } else if (frame_capacity > MAX_DLC && length <= frame_capacity - 2) {
+            // Single frame with CAN FD length escape
+            pci[0] = 0x00;
+            pci[1] = length;
+            header = 2;
+        } else if (length <= 0xFFF) {
+            // First frame
+            pci[0] = 0x10 | (length >> 8);
+            pci[1] = length;
+            header = 2;
+        } else {
+            // First frame with 32-bit length escape
+            pci[0] = 0x10;
+            pci[1] = 0x00;
+            for (int i = 0; i < 4; i++) {
+                pci[i+2] = static_cast<uint32_t>(length) >> ((3 - i) * 8);
+            }
+            header = 6;
+        }
+
+        size_t n_bytes = length < frame_capacity - header ? length : frame_capacity - header;
+        memcpy(&pci[header], data, n_bytes);
+        sendFrame_(header + n_bytes);
+
+        if (n_bytes < length) {
+            _tx_data = data;
+            _tx_length = length;
+            _tx_offset = n_bytes;
+            _tx_sequence = 1;
+            _tx_timer = _now_us;
+            _tx_state = tx_wait_flow_control;
+        }
+
+        return true;
+    }
+
+    /**
+     * Feeds a received frame to the channel.
+     * @param incoming_frame The received CAN frame.
+     * @param now_us The current time in microseconds, e.g. micros().
+     * @return True if the frame belongs to this channel, false otherwise.
+     */
+    bool onFrame(const FrameT *incoming_frame, uint32_t now_us) {
+        if (incoming_frame->arbitration_id != _rx_id || incoming_frame->dlc == 0) {
+            return false;
+        }
+
+        _now_us = now_us;
+
+        switch (incoming_frame->payload[0] >> 4) {
+            case 0:
+                receiveSingle_(incoming_frame);
+                break;
+            case 1:
+                receiveFirst_(incoming_frame);
+                break;
+            case 2:
+                receiveConsecutive_(incoming_frame);
+                break;
+            case 3:
+                receiveFlowControl_(incoming_frame);
+                break;
+            default:
+                break;
+        }
+
+        return true;
+    }
+
+    /**
+     * Sends the consecutive frames that are due and checks the timeouts.
+     * @param now_us The current time in microseconds, e.g. micros().
+     * @param max_frames The maximum number of frames to send. Each frame is sent with the
+     *                   blocking SerialCAN::send(), so this bounds the time spent here.
+     * @return The number of frames sent.
+     */
+    size_t poll(uint32_t now_us, size_t max_frames = 1) {
+        _now_us = now_us;
+
+        if (_rx_state == rx_receiving && now_us - _rx_timer > timeout_us) {
+            _fault_reason = rx_timeout;
+            _rx_state = rx_idle;
+        }
+
+        if (_tx_state == tx_wait_flow_control && now_us - _tx_timer > timeout_us) {
+            _fault_reason = tx_timeout;
+            _tx_state = tx_idle;
+        }
+
+        size_t n_frames = 0;
+        while (_tx_state == tx_send_consecutive && n_frames < max_frames) {
+            if (_tx_st_min_us > 0 && now_us - _tx_timer < _tx_st_min_us) {
+                break;
+            }
+
+            sendConsecutive_();
+            _tx_timer = now_us;
+            n_frames++;
+
+            // The clock does not advance within one call
+            if (_tx_st_min_us > 0) {
+                break;
+            }
+        }
+
+        return n_frames;
+    }
+
+    /**
+     * Checks if a transfer is in progress.
+     * @return True if a message is being sent.
+     */
+    bool sending() const { return _tx_state != tx_idle; }
+
+    /**
+     * Checks if a complete message has been received.
+     * @return True if a message is ready to be read with data().
+     */
+    bool available() const { return _rx_state == rx_complete; }
+
+    /**
+     * Gets the received message.
+     * @return Pointer to the reassembly buffer.
+     * @pre available() returns true.
+     */
+    const uint8_t *data() const { return _rx_buffer; }
+
+    /**
+     * Gets the length of the received message.
+     * @return The message length in bytes.
+     * @pre available() returns true.
+     */
+    size_t length() const { return _rx_length; }
+
+    /**
+     * Releases the received message so that the next one can be received.
+     */
+    void release() { _rx_state = rx_idle; }
+
+ private:
+    static constexpr size_t frame_capacity = FrameT::capacity();  /**< Bytes per frame. */
+
+    /**
+     * Sender states.
+     */
+    enum tx_state {
+        tx_idle,                  /**< No transfer in progress */
+        tx_wait_flow_control,     /**< Waiting for a flow control frame */
+        tx_send_consecutive       /**< Sending consecutive frames */
+    };
+
+    /**
+     * Receiver states.
+     */
+    enum rx_state {
+        rx_idle,                  /**< Waiting for a single or first frame */
+        rx_receiving,             /**< Waiting for consecutive frames */
+        rx_complete               /**< A complete message is waiting to be released */
+    };
+
+    /**
+     * Sends the first n_bytes of the transmit frame payload.
+     * @param n_bytes The number of payload bytes.
+     */
+    void sendFrame_(size_t n_bytes) {
+        _tx_frame.dlc = n_bytes;
+        _serial_can->send(&_tx_frame, _now_us / 1000);
+    }
+
+    /**
+     * Sends the next consecutive frame and advances the sender state.
+     */
+    void sendConsecutive_() {
+        size_t remaining = _tx_length - _tx_offset;
+        size_t n_bytes = remaining < frame_capacity - 1 ? remaining : frame_capacity - 1;
+
+        _tx_frame.payload[0] = 0x20 | _tx_sequence;
+        memcpy(&_tx_frame.payload[1], &_tx_data[_tx_offset], n_bytes);
+        sendFrame_(n_bytes + 1);
+
+        _tx_offset += n_bytes;
+        _tx_sequence = (_tx_sequence + 1) & 0x0F;
+
+        if (_tx_offset == _tx_length) {
+            _tx_state = tx_idle;
+        } else if (_tx_block_size != 0 && ++_tx_block_count == _tx_block_size) {
+            _tx_timer = _now_us;
+            _tx_state = tx_wait_flow_control;
+        }
+    }
+
+    /**
+     * Sends a flow control frame.
+     * @param status The flow status.
+     */
+    void sendFlowControl_(flow_status status) {
+        _tx_frame.payload[0] = 0x30 | status;
+        _tx_frame.payload[1] = _block_size;
+        _tx_frame.payload[2] = _st_min;
+        sendFrame_(3);
+    }
+
+    /**
+     * Checks that the reassembly buffer is free for a new message.
+     * @return True if a new message can be received.
+     */
+    bool acceptMessage_() {
+        if (_rx_state == rx_complete) {
+            _fault_reason = receive_overrun;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Handles a single frame.
+     * @param incoming_frame The received CAN frame.
+     */
+    void receiveSingle_(const FrameT *incoming_frame) {
+        const uint8_t *pci = incoming_frame->payload;
+        size_t length = pci[0] & 0x0F;
+        size_t header = 1;
+
+        if (length == 0 && incoming_frame->dlc > MAX_DLC) {
+            length = pci[1];
+            header = 2;
+        }
+
+        if (length == 0 || header + length > incoming_frame->dlc || !acceptMessage_()) {
+            return;
+        }
+
+        // A single frame also aborts a reception in progress
+        if (length > BufferSize) {
+            _fault_reason = buffer_overflow;
+            _rx_state = rx_idle;
+            return;
+        }
+
+        memcpy(_rx_buffer, &pci[header], length);
+        _rx_length = length;
+        _rx_state = rx_complete;
+    }
+
+    /**
+     * Handles a first frame and answers with a flow control frame.
+     * @param incoming_frame The received CAN frame.
+     */
+    void receiveFirst_(const FrameT *incoming_frame) {
+        const uint8_t *pci = incoming_frame->payload;
+        uint32_t length = (static_cast<uint32_t>(pci[0] & 0x0F) << 8) | pci[1];
+        size_t header = 2;
+
+        if (length == 0) {
+            for (int i = 0; i < 4; i++) {
+                length = (length << 8) | pci[i+2];
+            }
+            header = 6;
+        }
+
+        if (header >= incoming_frame->dlc || !acceptMessage_()) {
+            return;
+        }
+
+        if (length > BufferSize) {
+            _fault_reason = buffer_overflow;
+            _rx_state = rx_idle;
+            sendFlowControl_(overflow);
+            return;
+        }
+
+        size_t n_bytes = incoming_frame->dlc - header;
+        n_bytes = n_bytes < length ? n_bytes : length;
+        memcpy(_rx_buffer, &pci[header], n_bytes);
+
+        _rx_length = length;
+        _rx_offset = n_bytes;
+        _rx_sequence = 1;
+        _rx_block_count = 0;
+        _rx_timer = _now_us;
+        _rx_state = rx_receiving;
+        sendFlowControl_(continue_to_send);
+    }
+
+    /**
+     * Handles a consecutive frame.
+     * @param incoming_frame The received CAN frame.
+     */
+    void receiveConsecutive_(const FrameT *incoming_frame) {
+        if (_rx_state != rx_receiving) {
+            return;
+        }
+
+        if ((incoming_frame->payload[0] & 0x0F) != _rx_sequence) {
+            _fault_reason = wrong_sequence;
+            _rx_state = rx_idle;
+            return;
+        }
+
+        size_t remaining = _rx_length - _rx_offset;
+        size_t n_bytes = incoming_frame->dlc - 1;
+        n_bytes = n_bytes < remaining ? n_bytes : remaining;
+        memcpy(&_rx_buffer[_rx_offset], &incoming_frame->payload[1], n_bytes);
+
+        _rx_offset += n_bytes;
+        _rx_sequence = (_rx_sequence + 1) & 0x0F;
+        _rx_timer = _now_us;
+
+        if (_rx_offset == _rx_length) {
+            _rx_state = rx_complete;
+        } else if (_block_size != 0 && ++_rx_block_count == _block_size) {
+            _rx_block_count = 0;
+            sendFlowControl_(continue_to_send);
+        }
+    }
+
+    /**
+     * Handles a flow control frame for the transfer in progress.
+     * @param incoming_frame The received CAN frame.
+     */
+    void receiveFlowControl_(const FrameT *incoming_frame) {
+        if (_tx_state != tx_wait_flow_control || incoming_frame->dlc < 3) {
+            return;
+        }
+
+        switch (incoming_frame->payload[0] & 0x0F) {
+            case continue_to_send:
+                _tx_block_size = incoming_frame->payload[1];
+                _tx_block_count = 0;
+                _tx_st_min_us = stMinToMicros(incoming_frame->payload[2]);
+                _tx_timer = _now_us - _tx_st_min_us;
+                _tx_state = tx_send_consecutive;
+                break;
+            case wait:
+                _tx_timer = _now_us;
+                break;
+            default:
+                _fault_reason = buffer_overflow;
+                _tx_state = tx_idle;
+                break;
+        }
+    }
+
+    SerialCANT *_serial_can;            /**< SerialCAN object the frames are sent through. */
+    uint32_t _rx_id;                    /**< Arbitration ID of the received frames. */
+    FrameT _tx_frame;                   /**< Transmit frame, reused for every frame sent. */
+    uint8_t _block_size;                /**< Block size requested from the remote. */
+    uint8_t _st_min;                    /**< STmin requested from the remote. */
+    uint32_t _now_us = 0;               /**< Time of the last send(), onFrame() or poll(). */
+
+    tx_state _tx_state = tx_idle;       /**< Sender state. */
+    const uint8_t *_tx_data = nullptr;  /**< Message being sent. */
+    size_t _tx_length = 0;              /**< Length of the message being sent. */
+    size_t _tx_offset = 0;              /**< Number of bytes sent. */
+    uint8_t _tx_sequence = 0;           /**< Sequence number of the next consecutive frame. */
+    uint8_t _tx_block_size = 0;         /**< Block size granted by the remote. */
+    uint8_t _tx_block_count = 0;        /**< Consecutive frames sent in the current block. */
+    uint32_t _tx_st_min_us = 0;         /**< STmin granted by the remote. */
+    uint32_t _tx_timer = 0;             /**< Time of the last frame sent or flow control. */
+
+    rx_state _rx_state = rx_idle;       /**< Receiver state. */
+    uint8_t _rx_buffer[BufferSize];     /**< Reassembly buffer. */
+    size_t _rx_length = 0;              /**< Length of the message being received. */
+    size_t _rx_offset = 0;              /**< Number of bytes received. */
+    uint8_t _rx_sequence = 0;           /**< Expected sequence number. */
+    uint8_t _rx_block_count = 0;        /**< Consecutive frames received in the current block. */
+    uint32_t _rx_timer = 0;             /**< Time of the last frame received. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_ISOTP_HPP_
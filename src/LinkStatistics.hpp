@@ -0,0 +1,132 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_LINKSTATISTICS_HPP_
+#define SERIALCAN_SRC_LINKSTATISTICS_HPP_
+
+#include "Utils.hpp"
+
+// Defining SERIALCAN_DISABLE_STATISTICS removes the link statistics, including their
+// storage and the getStatistics() and resetStatistics() methods of SerialCAN.
+#ifdef SERIALCAN_DISABLE_STATISTICS
+    #define SERIALCAN_STATISTICS 0
+#else
+    #define SERIALCAN_STATISTICS 1
+#endif
+
+// Tick source of the timing statistics. Cortex-M3, M4 and M7 targets use the DWT cycle
+// counter, any other target micros(). Can be defined to any expression returning uint32_t.
+#ifndef SERIALCAN_STATISTICS_CLOCK
+    #if SERIALCAN_ARDUINO && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+        #define SERIALCAN_STATISTICS_CYCLE_COUNTER 1
+        #define SERIALCAN_STATISTICS_CLOCK() (*reinterpret_cast<volatile uint32_t *>(0xE0001004))
+    #else
+        #define SERIALCAN_STATISTICS_CLOCK() micros()
+    #endif
+#endif
+
+// Timing of the send and receive hot paths, enabled by default only with the DWT cycle
+// counter, which is read in a single cycle. Define it as 1 to time with micros() on other
+// targets, or as 0 to keep the counters only.
+#ifndef SERIALCAN_STATISTICS_TIMING
+    #ifdef SERIALCAN_STATISTICS_CYCLE_COUNTER
+        #define SERIALCAN_STATISTICS_TIMING 1
+    #else
+        #define SERIALCAN_STATISTICS_TIMING 0
+    #endif
+#endif
+#if !SERIALCAN_STATISTICS
+    #undef SERIALCAN_STATISTICS_TIMING
+    #define SERIALCAN_STATISTICS_TIMING 0
+#endif
+
+namespace serial_can {
+
+/**
+ * Number of fault counters, one per SerialCANBase::fault_reason.
+ */
+constexpr size_t LINK_FAULT_REASONS = 11;
+
+/**
+ * Number of buckets of the parse time histogram.
+ */
+constexpr size_t LINK_PARSE_TIME_BUCKETS = 16;
+
+/**
+ * Traffic and error counters of a SerialCAN link, see SerialCANBase::getStatistics().
+ * Tick values are clock cycles with the DWT cycle counter and microseconds otherwise,
+ * see SERIALCAN_STATISTICS_CLOCK.
+ */
+struct LinkStatistics {
+    uint32_t frames_sent;       /**< Frames written or queued for writing. */
+    uint32_t bytes_sent;        /**< Bytes written to the stream. */
+    uint32_t frames_received;   /**< Frames received, including frames of super-packets. */
+    uint32_t bytes_received;    /**< Bytes read from the stream. */
+    uint32_t discarded_bytes;   /**< Bytes dropped while hunting for a start byte. */
+    uint32_t max_rx_wait_ms;    /**< Longest time receive() waited for a frame. */
+    uint32_t faults[LINK_FAULT_REASONS];  /**< Faults by fault_reason, faults[none] is unused. */
+#if SERIALCAN_STATISTICS_TIMING
+    uint32_t max_send_ticks;    /**< Longest time spent in send() or trySend(). */
+    uint32_t max_parse_ticks;   /**< Longest time spent in a tryReceive() call with a frame. */
+
+    /**
+     * Frames by the time spent in the tryReceive() call that completed them. Bucket 0
+     * counts frames parsed within the same tick, bucket i > 0 frames parsed in 2^(i-1) to
+     * 2^i - 1 ticks, and the last bucket all slower frames.
+     */
+    uint32_t parse_time_histogram[LINK_PARSE_TIME_BUCKETS];
+#endif
+};
+
+/**
+ * Gets the histogram bucket of a parse time, see LinkStatistics::parse_time_histogram.
+ * @param ticks The parse time in ticks.
+ * @return The bucket index.
+ */
+inline size_t parseTimeBucket(uint32_t ticks) {
+    size_t bucket = 0;
+    while (ticks != 0 && bucket < LINK_PARSE_TIME_BUCKETS - 1) {
+        ticks >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Starts the tick source of the timing statistics, which only has to be enabled for the
+ * DWT cycle counter.
+ */
+inline void beginStatisticsClock() {
+#ifdef SERIALCAN_STATISTICS_CYCLE_COUNTER
+    // Enable tracing in DEMCR, then the cycle counter in DWT_CTRL
+    *reinterpret_cast<volatile uint32_t *>(0xE000EDFC) |= 1UL << 24;
+    *reinterpret_cast<volatile uint32_t *>(0xE0001000) |= 1UL;
+#endif
+}
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_LINKSTATISTICS_HPP_
@@ -0,0 +1,190 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_PRIORITYTXQUEUE_HPP_
+#define SERIALCAN_SRC_PRIORITYTXQUEUE_HPP_
+
+#include "SerialCAN.h"
+
+namespace serial_can {
+
+/**
+ * Bounded transmit queue that emulates CAN bus arbitration: whenever it is polled,
+ * the pending frame with the lowest arbitration ID is sent first. Frames with equal
+ * arbitration IDs are sent in the order they were queued.
+ *
+ * @tparam N The capacity in frames, no larger than 255.
+ * @tparam SerialCANT The SerialCAN type the frames are sent through.
+ */
+template<size_t N, typename SerialCANT = SerialCAN>
+class PriorityTxQueue {
+    static_assert(N > 0 && N < 256, "PriorityTxQueue capacity must be between 1 and 255");
+
+ public:
+    /**
+     * Type of the queued frames.
+     */
+    typedef typename SerialCANT::FrameT FrameT;
+
+    /**
+     * Constructor for PriorityTxQueue class.
+     * @param serial_can The SerialCAN object to send the queued frames through.
+     * @param replace_same_id If true, a queued frame is replaced by a newer frame with the
+     *                        same arbitration ID instead of queuing both.
+     */
+    explicit PriorityTxQueue(SerialCANT *serial_can, bool replace_same_id = false) :
+        _serial_can{serial_can}, _replace_same_id{replace_same_id} {
+        for (size_t i = 0; i < N; i++) {
+            _order[i] = i;
+        }
+    }
+
+    /**
+     * Copies a CAN frame into the queue and advances the counter of the caller's frame,
+     * as if it was sent. A frame that replaces a queued frame takes over its counter and
+     * leaves the caller's counter as it is, since the replaced frame is never sent.
+     * @param outgoing_frame The outgoing CAN frame to be queued.
+     * @return True if the frame was queued, false if the queue is full.
+     */
+    bool enqueue(FrameT *outgoing_frame) {
+        size_t position = lowerBound_(outgoing_frame->arbitration_id);
+
+        if (_replace_same_id && position < _count &&
+            _frames[_order[position]].arbitration_id == outgoing_frame->arbitration_id) {
+            FrameT &queued_frame = _frames[_order[position]];
+            uint8_t counter = queued_frame.counter;
+            queued_frame = *outgoing_frame;
+            queued_frame.counter = counter;
+            return true;
+        }
+
+        if (full()) {
+            return false;
+        }
+
+        // Keep frames with equal IDs in FIFO order
+        while (position < _count &&
+            _frames[_order[position]].arbitration_id == outgoing_frame->arbitration_id) {
+            position++;
+        }
+
+        // Move the first free slot into its sorted position
+        uint8_t slot = _order[_count];
+        for (size_t i = _count; i > position; i--) {
+            _order[i] = _order[i-1];
+        }
+        _order[position] = slot;
+        _count++;
+
+        _frames[slot] = *outgoing_frame;
+        outgoing_frame->counter++;
+        return true;
+    }
+
+    /**
+     * Sends the queued frames with the lowest arbitration IDs.
+     * @param timestamp The timestamp of the sent CAN frames.
+     * @param max_frames The maximum number of frames to send.
+     * @return The number of frames sent.
+     */
+    size_t poll(uint32_t timestamp, size_t max_frames = 1) {
+        size_t n_frames = 0;
+
+        while (_count > 0 && n_frames < max_frames) {
+            uint8_t slot = _order[0];
+            _serial_can->send(&_frames[slot], timestamp);
+
+            // Return the slot to the free part of the order array
+            for (size_t i = 1; i < _count; i++) {
+                _order[i-1] = _order[i];
+            }
+            _order[--_count] = slot;
+            n_frames++;
+        }
+
+        return n_frames;
+    }
+
+    /**
+     * Get the pending frame with the lowest arbitration ID.
+     * @return Pointer to the frame that is sent next, or nullptr if the queue is empty.
+     */
+    const FrameT *peek() const { return _count > 0 ? &_frames[_order[0]] : nullptr; }
+
+    /**
+     * Get the number of frames in the queue.
+     * @return The number of frames.
+     */
+    size_t size() const { return _count; }
+
+    /**
+     * Get the capacity of the queue.
+     * @return The maximum number of frames.
+     */
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * Checks if the queue is empty.
+     * @return True if there are no frames in the queue.
+     */
+    bool empty() const { return _count == 0; }
+
+    /**
+     * Checks if the queue is full.
+     * @return True if there is no free slot in the queue.
+     */
+    bool full() const { return _count == N; }
+
+ private:
+    /**
+     * Finds the first position in the order array whose frame ID is not lower than id.
+     * @param id The arbitration ID to search for.
+     * @return The position in the order array.
+     */
+    size_t lowerBound_(uint32_t id) const {
+        size_t low = 0;
+        size_t high = _count;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (_frames[_order[middle]].arbitration_id < id) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    SerialCANT *_serial_can;  /**< Pointer to the SerialCAN object. */
+    bool _replace_same_id;    /**< Replace queued frames with the same arbitration ID. */
+    FrameT _frames[N];        /**< Frame storage. */
+    uint8_t _order[N];        /**< Slots sorted by arbitration ID, followed by the free slots. */
+    size_t _count = 0;        /**< Number of queued frames. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_PRIORITYTXQUEUE_HPP_
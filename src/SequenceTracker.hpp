@@ -0,0 +1,226 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_SEQUENCETRACKER_HPP_
+#define SERIALCAN_SRC_SEQUENCETRACKER_HPP_
+
+#include "Utils.hpp"
+
+namespace serial_can {
+
+/**
+ * Counters of the sequence tracker.
+ */
+struct SequenceStatistics {
+    uint32_t in_order_frames;       /**< Frames with the expected counter. */
+    uint32_t lost_frames;           /**< Frames missing from the counter sequence. */
+    uint32_t repeated_frames;       /**< Frames with the same counter as the previous one. */
+    uint32_t out_of_order_frames;   /**< Frames with a counter older than the previous one. */
+    uint32_t untracked_frames;      /**< Frames of IDs that did not fit into the table. */
+};
+
+/**
+ * Receive-side tracking of the counter of CRC protected frames, per arbitration ID.
+ * The counter of each ID is compared to the last one received, which detects lost,
+ * repeated and reordered frames that have a valid CRC.
+ *
+ * IDs are added to the table, kept sorted and searched with binary search, when their
+ * first frame arrives. Frames of further IDs are counted as untracked once it is full.
+ */
+class SequenceTracker {
+ public:
+    /**
+     * Result of tracking a frame.
+     */
+    enum sequence_status {
+        sequence_in_order,      /**< The counter is the expected one, or the first of its ID. */
+        sequence_lost,          /**< Frames before this one were lost. */
+        sequence_repeated,      /**< The counter is the same as the previous one. */
+        sequence_out_of_order,  /**< The counter is older than the previous one. */
+        sequence_untracked      /**< The table is full and the ID is not in it. */
+    };
+
+    /**
+     * Counter state of one arbitration ID.
+     */
+    struct Entry {
+        uint32_t id;            /**< The arbitration ID. */
+        uint16_t lost_frames;   /**< Frames of the ID that were lost, saturating. */
+        uint8_t counter;        /**< The last counter received in order. */
+    };
+
+    /**
+     * Checks the counter of a received frame against the previous one of its ID.
+     * A gap of up to half the counter range counts as lost frames, a larger one as a
+     * frame that arrived out of order, which leaves the expected counter unchanged.
+     * @param id The arbitration ID of the frame.
+     * @param counter The counter of the frame.
+     * @return The classification of the frame.
+     */
+    sequence_status track(uint32_t id, uint8_t counter) {
+        _last_gap = 0;
+        size_t position = lowerBound_(id);
+
+        if (position == _n_entries || _entries[position].id != id) {
+            if (!insert_(position, id)) {
+                _statistics.untracked_frames++;
+                return sequence_untracked;
+            }
+            _entries[position].counter = counter;
+            _statistics.in_order_frames++;
+            return sequence_in_order;
+        }
+
+        Entry &entry = _entries[position];
+        uint8_t gap = counter - static_cast<uint8_t>(entry.counter + 1);
+
+        if (gap == 0) {
+            entry.counter = counter;
+            _statistics.in_order_frames++;
+            return sequence_in_order;
+        } else if (gap == 0xFF) {
+            _statistics.repeated_frames++;
+            return sequence_repeated;
+        } else if (gap >= 0x80) {
+            _statistics.out_of_order_frames++;
+            return sequence_out_of_order;
+        }
+
+        entry.counter = counter;
+        entry.lost_frames = entry.lost_frames + gap > 0xFFFF ? 0xFFFF : entry.lost_frames + gap;
+        _statistics.lost_frames += gap;
+        _last_gap = gap;
+        return sequence_lost;
+    }
+
+    /**
+     * Get the number of frames lost before the last tracked frame.
+     * @return The number of lost frames, 0 unless track() returned sequence_lost.
+     */
+    uint8_t getLastGap() const { return _last_gap; }
+
+    /**
+     * Get the number of lost frames of an arbitration ID.
+     * @param id The arbitration ID.
+     * @return The number of lost frames, 0 if the ID is not tracked.
+     */
+    uint16_t getLostFrames(uint32_t id) const {
+        size_t position = lowerBound_(id);
+        return position < _n_entries && _entries[position].id == id ?
+            _entries[position].lost_frames : 0;
+    }
+
+    /**
+     * Get the counters of all tracked frames.
+     * @return The counters.
+     */
+    const SequenceStatistics &getStatistics() const { return _statistics; }
+
+    /**
+     * Forgets all IDs and resets the counters, e.g. after the sender restarted.
+     */
+    void reset() {
+        _n_entries = 0;
+        _statistics = SequenceStatistics{};
+    }
+
+    /**
+     * Get the number of tracked IDs.
+     * @return The number of IDs.
+     */
+    size_t size() const { return _n_entries; }
+
+ protected:
+    /**
+     * Constructor for SequenceTracker class.
+     * @param entries Storage for the counter states.
+     * @param max_entries The number of IDs the storage can hold.
+     */
+    SequenceTracker(Entry *entries, size_t max_entries) :
+        _entries{entries}, _max_entries{max_entries} {}
+
+ private:
+    /**
+     * Finds the first entry whose ID is not lower than id.
+     * @param id The arbitration ID to search for.
+     * @return The position in the table.
+     */
+    size_t lowerBound_(uint32_t id) const {
+        size_t low = 0;
+        size_t high = _n_entries;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (_entries[middle].id < id) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * Inserts an ID at its sorted position.
+     * @param position The position returned by lowerBound_().
+     * @param id The arbitration ID.
+     * @return False if the table is full.
+     */
+    bool insert_(size_t position, uint32_t id) {
+        if (_n_entries == _max_entries) {
+            return false;
+        }
+        for (size_t i = _n_entries; i > position; i--) {
+            _entries[i] = _entries[i-1];
+        }
+        _entries[position] = Entry{id, 0, 0};
+        _n_entries++;
+        return true;
+    }
+
+    Entry *_entries;                    /**< Counter states sorted by ID. */
+    size_t _max_entries;                /**< Capacity of the table. */
+    size_t _n_entries = 0;              /**< Number of tracked IDs. */
+    SequenceStatistics _statistics{};   /**< Counters of all tracked frames. */
+    uint8_t _last_gap = 0;              /**< Frames lost before the last tracked frame. */
+};
+
+/**
+ * Sequence tracker with statically allocated storage.
+ *
+ * @tparam MaxIds The maximum number of tracked arbitration IDs.
+ */
+template<size_t MaxIds>
+class StaticSequenceTracker : public SequenceTracker {
+ public:
+    StaticSequenceTracker() : SequenceTracker(_entry_storage, MaxIds) {}
+
+ private:
+    Entry _entry_storage[MaxIds];       /**< Counter state storage. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_SEQUENCETRACKER_HPP_
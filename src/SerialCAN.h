@@ -32,13 +32,63 @@
 #include <assert.h>
 #include "Utils.hpp"
 #include "Frame.hpp"
+#include "CRC8.hpp"
+#include "COBS.hpp"
+#include "FrameRingBuffer.hpp"
+#include "FramePool.hpp"
+#include "FilterBank.hpp"
+#include "SequenceTracker.hpp"
+#include "LinkStatistics.hpp"
+#include "FrameDispatcher.hpp"
+
+#if !SERIALCAN_ARDUINO
+// HardwareSerial only exists on Arduino, SerialCAN can be named but not used on host builds.
+class HardwareSerial;
+#endif
 
 namespace serial_can {
 
+constexpr uint8_t FRAME_START_BYTE = 0xAA;  /**< First byte of every serial CAN frame. */
+constexpr uint8_t FRAME_END_BYTE = 0xBB;    /**< Last byte of every serial CAN frame. */
+constexpr size_t FRAME_HEADER_SIZE = 10;    /**< Start byte, timestamp, DLC and arbitration ID. */
+constexpr uint8_t PACKET_START_BYTE = 0xAB; /**< First byte of every serial super-packet. */
+constexpr size_t PACKET_HEADER_SIZE = 6;    /**< Start byte, record count and base timestamp. */
+constexpr uint8_t PACKET_LONG_ID_FLAG = 0x20;  /**< Record DLC flag for 4-byte arbitration IDs. */
+constexpr uint8_t COMPACT_START_BYTE = 0xA5;   /**< First byte of every compact header frame. */
+constexpr uint8_t COMPACT_LONG_ID_FLAG = 0x10; /**< Compact flags bit for 29-bit arbitration IDs. */
+constexpr uint8_t COMPACT_TIMESTAMP_SHIFT = 5; /**< Position of the compact timestamp width code. */
+
 /**
- * SerialCAN class for CAN communication over Serial bus.
+ * Maximum size in bytes of a serial CAN frame, including start and end bytes.
+ */
+constexpr size_t MAX_SERIAL_FRAME_SIZE = FRAME_HEADER_SIZE + MAX_DLC + 1;
+
+/**
+ * Maximum size in bytes of a serial CAN FD frame, including start and end bytes.
+ */
+constexpr size_t MAX_FD_SERIAL_FRAME_SIZE = FRAME_HEADER_SIZE + MAX_FD_DLC + 1;
+
+#ifndef SERIALCAN_COMPACT_SYNC_INTERVAL
+/**
+ * Number of compact header frames with a delta timestamp sent between two frames with an
+ * absolute timestamp, which resynchronize receivers that missed a frame.
+ */
+#define SERIALCAN_COMPACT_SYNC_INTERVAL 32
+#endif
+
+#ifndef SERIALCAN_TX_BATCH_BUFFER_SIZE
+/**
+ * Size in bytes of the stack buffer used by SerialCAN::sendBatch() and SerialCAN::sendPacket().
+ * Frames are flushed with one write call each time the buffer is full, so this is also the
+ * maximum size of a super-packet.
  */
-class SerialCAN {
+#define SERIALCAN_TX_BATCH_BUFFER_SIZE (4 * MAX_SERIAL_FRAME_SIZE)
+#endif
+
+/**
+ * Stream independent part of the SerialCAN class.
+ */
+class SerialCANBase {
  public:
     /**
      * Reason for a fault in the SerialCAN class.
@@ -48,15 +98,245 @@ class SerialCAN {
         timeout,                /**< Timeout occurred. */
         no_incoming_data,       /**< No incoming data. */
         crc_mismatch,           /**< CRC mismatch. */
-        missing_end_delimeter    /**< Missing end delimiter. */
+        missing_end_delimeter,   /**< Missing end delimiter. */
+        invalid_dlc,            /**< DLC larger than the maximum payload size. */
+        packet_too_large,       /**< Super-packet larger than the packet receive buffer. */
+        framing_error,          /**< COBS block ended inside a frame. */
+        frames_lost,            /**< Frames before the received one were lost. */
+        frame_repeated,         /**< Received frame repeats the previous counter. */
+        frame_out_of_order      /**< Received frame is older than the previous one. */
     };
+    static_assert(frame_out_of_order + 1 == LINK_FAULT_REASONS,
+        "LinkStatistics needs one fault counter per fault_reason");
+
+    /**
+     * Result of a non-blocking receive call.
+     */
+    enum receive_status {
+        need_more_bytes,        /**< No complete frame yet, call again when more data arrives. */
+        frame_ready,            /**< A complete frame has been received. */
+        frame_error             /**< A frame was discarded, see getFaultReason(). */
+    };
+
+    /**
+     * Header layout of outgoing frames.
+     */
+    enum header_format {
+        standard_header,        /**< python-can compatible header, the default. */
+        compact_header          /**< Variable-length header with delta timestamps. */
+    };
+
+    /**
+     * Framing of frames on the serial line.
+     */
+    enum framing {
+        marker_framing,         /**< Frames are found by their start and end bytes, the default. */
+        cobs_framing            /**< Frames are COBS encoded and delimited by 0x00. */
+    };
+
+    /**
+     * Get the reason for the fault in the SerialCAN class.
+     * @return The fault reason.
+     */
+    fault_reason getFaultReason(void) { return _fault_reason; }
+
+    /**
+     * Calculates the CRC8 value for a given message with the CRC8 engine selected by
+     * SERIALCAN_CRC8_ENGINE (see CRC8.hpp).
+     * @param message The message for which to calculate the CRC8 value.
+     * @param nBytes The number of bytes in the message.
+     * @return The CRC8 value.
+     */
+    uint8_t getCRC8(uint8_t const message[], int nBytes) { return crc8(message, nBytes); }
+
+    /**
+     * Sets the mask/ID acceptance filters for incoming frames.
+     * Filters are checked as soon as the arbitration ID has been received, and rejected
+     * frames are dropped without being decoded or CRC checked.
+     * @param filters Array of mask filters, which must outlive the SerialCAN object.
+     * @param n_filters The number of filters in the array.
+     */
+    void setMaskFilters(const MaskFilter *filters, size_t n_filters) {
+        _filter_bank.setMaskFilters(filters, n_filters);
+    }
+
+    /**
+     * Sets the exactly matched arbitration IDs for incoming frames.
+     * @param sorted_ids Array of IDs sorted in ascending order, which must outlive the
+     *                   SerialCAN object.
+     * @param n_ids The number of IDs in the array.
+     */
+    void setExactIdFilter(const uint32_t *sorted_ids, size_t n_ids) {
+        _filter_bank.setExactIds(sorted_ids, n_ids);
+    }
+
+    /**
+     * Removes all acceptance filters, so that all incoming frames are accepted.
+     */
+    void clearFilters(void) { _filter_bank.clear(); }
+
+    /**
+     * Get the number of incoming frames dropped by the acceptance filters.
+     * @return The number of rejected frames.
+     */
+    uint32_t getRejectedFrameCount(void) { return _rejected_frames; }
+
+    /**
+     * Sets the tracker that checks the counters of incoming CRC protected frames.
+     * Frames that are lost, repeated or out of order are still received, with
+     * getFaultReason() returning frames_lost, frame_repeated or frame_out_of_order.
+     * @param tracker The tracker, e.g. a StaticSequenceTracker, which must outlive the
+     *                SerialCAN object, or nullptr to stop tracking.
+     */
+    void setSequenceTracker(SequenceTracker *tracker) { _sequence_tracker = tracker; }
+
+#if SERIALCAN_STATISTICS
+    /**
+     * Gets a snapshot of the link statistics, which are removed by defining
+     * SERIALCAN_DISABLE_STATISTICS. When frames are received in an interrupt, e.g. with
+     * receiveInto(), call it with interrupts disabled to get consistent counters.
+     * @return A copy of the statistics.
+     */
+    LinkStatistics getStatistics(void) const { return _statistics; }
+
+    /**
+     * Resets all link statistics to zero.
+     */
+    void resetStatistics(void) { _statistics = LinkStatistics(); }
+#endif
+
+    /**
+     * Selects the header layout of outgoing frames. The receiver has to accept compact
+     * headers with enableCompactHeaders() before the sender switches to them.
+     *
+     *     0xA5 | flags | timestamp (1, 2 or 4) | ID (2 or 4) | payload | 0xBB
+     *
+     * The flags byte holds the DLC code in bits 0-3, COMPACT_LONG_ID_FLAG for 29-bit IDs,
+     * the timestamp width code in bits 5-6 and the fd_frame flag in bit 7. Widths 1 and 2
+     * carry the delta to the previous frame's timestamp, width 4 the absolute timestamp,
+     * which is sent for the first frame and every SERIALCAN_COMPACT_SYNC_INTERVAL frames.
+     * The bitrate_switch flag is not carried by compact headers.
+     * @param format The header layout.
+     */
+    void setHeaderFormat(header_format format) {
+        _header_format = format;
+        _tx_sync_countdown = 0;
+    }
+
+    /**
+     * Get the header layout of outgoing frames.
+     * @return The header layout.
+     */
+    header_format getHeaderFormat(void) { return _header_format; }
+
+    /**
+     * Enables receiving frames with the compact header, see setHeaderFormat(). Standard
+     * header frames are always received. Compact header frames are ignored by default, so
+     * that stray 0xA5 bytes are not taken for frame starts on links where the peer only
+     * sends standard headers.
+     * @param enable True to accept compact header frames.
+     */
+    void enableCompactHeaders(bool enable = true) { _rx_compact_headers = enable; }
+
+    /**
+     * Get the framing of frames on the serial line.
+     * @return The framing.
+     */
+    framing getFraming(void) { return _framing; }
+
+ protected:
+    fault_reason _fault_reason = none; /**< Reason for a fault in the SerialCAN class. */
+    FilterBank _filter_bank;           /**< Acceptance filters for incoming frames. */
+    uint32_t _rejected_frames = 0;     /**< Number of frames rejected by the filters. */
+    SequenceTracker *_sequence_tracker = nullptr;  /**< Counter checks of incoming frames. */
+    header_format _header_format = standard_header;  /**< Header layout of outgoing frames. */
+    bool _rx_compact_headers = false;  /**< Accept incoming compact header frames. */
+    uint32_t _tx_last_timestamp = 0;   /**< Timestamp of the last compact header frame sent. */
+    uint8_t _tx_sync_countdown = 0;    /**< Delta timestamps left before the next absolute. */
+    framing _framing = marker_framing; /**< Framing of frames on the serial line. */
+#if SERIALCAN_STATISTICS
+    LinkStatistics _statistics = {};   /**< Traffic and error counters. */
+#endif
+
+    /**
+     * Counts the current fault in the link statistics, if there is one.
+     */
+    void countFault_(void) {
+#if SERIALCAN_STATISTICS
+        if (_fault_reason != none) {
+            _statistics.faults[_fault_reason]++;
+        }
+#endif
+    }
+
+    /**
+     * Counts sent frames in the link statistics.
+     * @param n_frames The number of frames.
+     */
+    void countSentFrames_(size_t n_frames) {
+#if SERIALCAN_STATISTICS
+        _statistics.frames_sent += n_frames;
+#else
+        static_cast<void>(n_frames);
+#endif
+    }
+};
+
+/**
+ * SerialCAN class for CAN communication over Serial bus.
+ * The stream type is a template parameter so that stream calls can be inlined and the
+ * codec can be used with any stream offering available(), read(), write(uint8_t) and
+ * write(const uint8_t*, size_t), e.g. HardwareSerial, SoftwareSerial, USB CDC serial
+ * or a POSIX file descriptor on a host.
+ *
+ * CAN FD frames carry the fd_frame and bitrate_switch flags in the upper bits of the DLC
+ * byte and use the DLC codes 9 to 15 for payloads of 12 to 64 bytes. Classic frames are
+ * serialized exactly as before, so the classic format stays python-can compatible.
+ *
+ * @tparam StreamT The stream type used for serial communication.
+ * @tparam MaxDLC The maximum payload size, MAX_DLC for classic CAN or MAX_FD_DLC for CAN FD.
+ */
+template<typename StreamT, size_t MaxDLC = MAX_DLC>
+class BasicSerialCAN : public SerialCANBase {
+    static_assert(MaxDLC == MAX_DLC || MaxDLC == MAX_FD_DLC,
+        "MaxDLC must be MAX_DLC or MAX_FD_DLC");
+
+ public:
+    /**
+     * Type of the frames sent and received.
+     */
+    typedef BasicFrame<MaxDLC> FrameT;
+
+    /**
+     * Type of the frame handler table used by dispatch().
+     */
+    typedef BasicFrameDispatcher<FrameT> Dispatcher;
+
+    /**
+     * Maximum size in bytes of a serial frame, including start and end bytes.
+     */
+    static constexpr size_t max_frame_size = FRAME_HEADER_SIZE + MaxDLC + 1;
+
+    /**
+     * Maximum size in bytes of a frame record in a super-packet.
+     */
+    static constexpr size_t max_record_size = 7 + MaxDLC;
+
+    /**
+     * Size in bytes of a super-packet holding one frame record of the maximum size.
+     */
+    static constexpr size_t min_packet_size = PACKET_HEADER_SIZE + max_record_size + 2;
+
+    /**
+     * Maximum size in bytes of a frame on the serial line, including COBS overhead.
+     */
+    static constexpr size_t max_wire_size = max_frame_size + cobsMaxOverhead(max_frame_size) + 1;
 
     /**
      * Constructor for SerialCAN class.
-     * @param streamObject The HardwareSerial object for serial communication.
+     * @param streamObject The stream object for serial communication.
      */
-    explicit SerialCAN(HardwareSerial *streamObject) :
-        _streamRef{streamObject}, _fault_reason{none} {}
+    explicit BasicSerialCAN(StreamT *streamObject) : _streamRef{streamObject} {}
 
 
     /**
@@ -69,8 +349,89 @@ class SerialCAN {
      * Sends a CAN frame over the SerialCAN bus.
      * @param outgoing_frame The outgoing CAN frame to be sent.
      * @param timestamp The timestamp of the CAN frame.
+     * @pre Frames with use_crc set to crc8 have a dlc of at least 2, for the counter and
+     *      CRC bytes. The same holds for all other send methods.
+     */
+    void send(FrameT *outgoing_frame, uint32_t timestamp);
+
+    /**
+     * Sends several CAN frames over the SerialCAN bus, packed into one contiguous buffer
+     * that is written to the stream with as few write calls as possible.
+     * @param outgoing_frames Array of outgoing CAN frames to be sent.
+     * @param n_frames The number of frames in outgoing_frames.
+     * @param timestamp The timestamp of the CAN frames.
+     */
+    void sendBatch(FrameT *outgoing_frames, size_t n_frames, uint32_t timestamp);
+
+    /**
+     * Sends several CAN frames over the SerialCAN bus as super-packets, which share one
+     * start byte, base timestamp, CRC and end byte between all frames of the packet:
+     *
+     *     0xAB | count | base timestamp (4) | records | CRC8 | 0xBB
+     *
+     * Each record holds the DLC byte, the timestamp relative to the base timestamp (2) and
+     * the arbitration ID (2, or 4 if PACKET_LONG_ID_FLAG is set in the DLC byte), followed
+     * by the payload. The CRC covers everything from the record count to the last record.
+     * A new packet is started when the buffer is full or a timestamp delta does not fit in
+     * 16 bits. The receiver has to call enablePackets().
+     * @param outgoing_frames Array of outgoing CAN frames, each with its timestamp set.
+     * @param n_frames The number of frames in outgoing_frames.
+     */
+    void sendPacket(FrameT *outgoing_frames, size_t n_frames);
+
+    /**
+     * Enables receiving super-packets, see sendPacket(). A packet is only delivered once
+     * its CRC has been checked, so it is buffered as a whole in the given buffer. Its frames
+     * are then returned one by one by tryReceive(), receive() and receiveInto().
+     * @param buffer The packet receive buffer, which must outlive the SerialCAN object.
+     * @param size The size of the buffer, at least as large as the largest packet sent and
+     *             no smaller than min_packet_size.
+     */
+    void enablePackets(uint8_t *buffer, size_t size);
+
+    /**
+     * Selects the framing of outgoing and incoming frames. Both ends have to use the same
+     * framing.
+     *
+     * With cobs_framing every frame, or super-packet, is encoded with Consistent Overhead
+     * Byte Stuffing and followed by a 0x00 delimiter, which cannot occur inside a frame.
+     * This costs 2 bytes per frame, but a corrupt frame never hides the start of the next
+     * one: the receiver drops the rest of the block and resumes at the next delimiter.
+     * @param mode The framing.
+     */
+    void setFraming(framing mode);
+
+    /**
+     * Enables trySend() and flushSome() with the given transmit byte queue.
+     * @param buffer The transmit queue storage, which must outlive the SerialCAN object.
+     * @param size The size of the buffer, no smaller than max_wire_size.
+     */
+    void enableTxQueue(uint8_t *buffer, size_t size);
+
+    /**
+     * Queues a CAN frame for sending without blocking. Queued bytes are written with
+     * flushSome(), which is also called once here, so the time spent in trySend() is
+     * bounded by the size of one frame.
+     * @param outgoing_frame The outgoing CAN frame to be sent.
+     * @param timestamp The timestamp of the CAN frame.
+     * @return True if the frame was queued, false if the queue is full. A rejected frame
+     *         is left untouched, including its counter.
+     * @pre A transmit queue has been set with enableTxQueue().
+     */
+    bool trySend(FrameT *outgoing_frame, uint32_t timestamp);
+
+    /**
+     * Writes as many queued bytes as the stream accepts without blocking, as reported by
+     * availableForWrite(). Call it regularly, e.g. once per loop().
+     * @return The number of bytes written.
+     */
+    size_t flushSome();
+
+    /**
+     * Get the number of bytes waiting in the transmit queue.
+     * @return The number of queued bytes.
      */
-    void send(Frame *outgoing_frame, uint32_t timestamp);
+    size_t getTxQueueLength() { return _tx_queue_length; }
 
     /**
      * Receives a CAN frame from the SerialCAN bus.
@@ -78,65 +439,397 @@ class SerialCAN {
      * @param timeout_ms The timeout in milliseconds for receiving the frame.
      * @return True if a frame was received successfully, false otherwise.
      */
-    bool receive(Frame *incoming_frame, uint32_t timeout_ms);
+    bool receive(FrameT *incoming_frame, uint32_t timeout_ms);
 
     /**
-     * Get the reason for the fault in the SerialCAN class.
-     * @return The fault reason.
+     * Receives a CAN frame from the SerialCAN bus without blocking.
+     * Consumes the bytes that are currently available and keeps the parser position
+     * between calls, so a partially received frame is resumed on the next call.
+     * When a frame is discarded, the bytes after its start byte are rescanned for the
+     * next frame start, so frames that begin inside a corrupt frame are not lost.
+     * @param incoming_frame The incoming CAN frame to be received.
+     * @return frame_ready if incoming_frame was populated, need_more_bytes if the
+     *         frame is not complete yet, or frame_error if a frame was discarded.
      */
-    fault_reason getFaultReason(void) { return _fault_reason; }
+    receive_status tryReceive(FrameT *incoming_frame);
 
     /**
-     * Calculates the CRC8 value for a given message.
-     * @param message The message for which to calculate the CRC8 value.
-     * @param nBytes The number of bytes in the message.
-     * @return The CRC8 value.
+     * Receives a CAN frame without blocking and, if it has the standard layout, without
+     * decoding its payload, so that it can be forwarded with sendRaw().
+     * @param incoming_frame The incoming CAN frame. For standard layout frames only the
+     *                       header fields are populated, otherwise the whole frame.
+     * @param raw_frame Set to the serialized frame in the receive buffer, valid until the
+     *                  next receive call, or to nullptr if incoming_frame was decoded.
+     * @return frame_ready if a frame was received, need_more_bytes if the frame is not
+     *         complete yet, or frame_error if a frame was discarded.
+     */
+    receive_status tryReceiveRaw(FrameT *incoming_frame, const uint8_t **raw_frame);
+
+    /**
+     * Sends a frame returned by tryReceiveRaw() as is, apart from its arbitration ID.
+     * The serialized bytes are copied without decoding, unless the compact header is
+     * enabled on this SerialCAN object.
+     * @param raw_frame The serialized frame, in the standard layout.
+     * @param arbitration_id The arbitration ID to send the frame with.
+     */
+    void sendRaw(const uint8_t *raw_frame, uint32_t arbitration_id);
+
+    /**
+     * Receives all available CAN frames and calls the handlers registered with onFrame()
+     * and onFrameRange(). Frames without a handler are dropped.
+     * @param use_crc Whether the incoming frames are protected with CRC.
+     * @return The number of frames passed to a handler.
+     * @pre A handler table has been set with setDispatcher().
+     */
+    size_t dispatch(FrameBase::crc_settings use_crc = FrameBase::no_crc);
+
+    /**
+     * Sets the handler table used by onFrame(), onFrameRange() and dispatch().
+     * @param dispatcher The handler table, e.g. a StaticFrameDispatcher, which must outlive
+     *                   the SerialCAN object.
+     */
+    void setDispatcher(Dispatcher *dispatcher) { _dispatcher = dispatcher; }
+
+    /**
+     * Registers a handler for a single arbitration ID.
+     * @param id The arbitration ID.
+     * @param handler The handler to be called by dispatch() for frames with the ID.
+     * @return True if the handler was registered, false if the table is full.
+     * @pre A handler table has been set with setDispatcher().
+     */
+    bool onFrame(uint32_t id, typename Dispatcher::Handler handler) {
+        assert(_dispatcher != nullptr);
+        return _dispatcher->onFrame(id, handler);
+    }
+
+    /**
+     * Registers a handler for all arbitration IDs where (arbitration_id & mask) == (id & mask).
+     * @param mask The ID bits that have to match.
+     * @param id The arbitration ID to match.
+     * @param handler The handler to be called by dispatch() for matching frames.
+     * @return True if the handler was registered, false if the table is full.
+     * @pre A handler table has been set with setDispatcher().
+     */
+    bool onFrameRange(uint32_t mask, uint32_t id, typename Dispatcher::Handler handler) {
+        assert(_dispatcher != nullptr);
+        return _dispatcher->onFrameRange(mask, id, handler);
+    }
+
+    /**
+     * Parses all available CAN frames from the SerialCAN bus straight into a ring buffer.
+     * Intended to be called from the producer side, e.g. serialEvent() or a UART RX
+     * interrupt, while the main loop pops the frames. Stops early when the ring buffer
+     * is full, leaving the remaining bytes in the stream.
+     * @param queue The ring buffer to be populated.
+     * @param use_crc Whether the incoming frames are protected with CRC.
+     * @return The number of frames pushed into the ring buffer.
+     */
+    template<size_t N>
+    size_t receiveInto(FrameRingBuffer<N, FrameT> *queue,
+        FrameBase::crc_settings use_crc = FrameBase::no_crc) {
+        size_t n_frames = 0;
+        FrameT *slot;
+
+        while ((slot = queue->writeSlot()) != nullptr) {
+            slot->use_crc = use_crc;
+
+            receive_status status = tryReceive(slot);
+            if (status == frame_ready) {
+                queue->commit();
+                n_frames++;
+            } else if (status == need_more_bytes) {
+                break;
+            }
+        }
+
+        return n_frames;
+    }
+
+    /**
+     * Sends a pooled CAN frame and returns it to the pool.
+     * @param pool The pool holding the frame.
+     * @param handle The handle of the outgoing CAN frame, released after sending.
+     * @param timestamp The timestamp of the CAN frame.
+     */
+    template<size_t N>
+    void send(FramePool<N, FrameT> *pool, FrameHandle handle, uint32_t timestamp) {
+        send(pool->get(handle), timestamp);
+        pool->release(handle);
+    }
+
+    /**
+     * Receives a CAN frame without blocking, directly into a frame taken from a pool.
+     * The frame is only kept if a complete frame was received, otherwise it is released.
+     * @param pool The pool to take the frame from.
+     * @param handle Set to the handle of the received frame if frame_ready is returned.
+     * @param use_crc Whether the incoming frame is protected with CRC.
+     * @return The result of tryReceive(), or need_more_bytes without reading the stream if
+     *         the pool is empty.
      */
-    uint8_t getCRC8(uint8_t const message[], int nBytes);
+    template<size_t N>
+    receive_status tryReceive(FramePool<N, FrameT> *pool, FrameHandle *handle,
+        FrameBase::crc_settings use_crc = FrameBase::no_crc) {
+        FrameHandle slot = pool->acquire();
+        if (slot == INVALID_FRAME_HANDLE) {
+            return need_more_bytes;
+        }
+
+        FrameT *incoming_frame = pool->get(slot);
+        incoming_frame->use_crc = use_crc;
+
+        receive_status status = tryReceive(incoming_frame);
+        if (status == frame_ready) {
+            *handle = slot;
+        } else {
+            pool->release(slot);
+        }
+        return status;
+    }
+
+    /**
+     * Receives all available CAN frames into frames taken from a pool and pushes their
+     * handles into a ring buffer, until the stream, the pool or the ring buffer runs out.
+     * @param pool The pool to take the frames from.
+     * @param queue The ring buffer of handles to be populated.
+     * @param use_crc Whether the incoming frames are protected with CRC.
+     * @return The number of handles pushed into the ring buffer.
+     */
+    template<size_t N, size_t M>
+    size_t receiveInto(FramePool<N, FrameT> *pool, FrameRingBuffer<M, FrameHandle> *queue,
+        FrameBase::crc_settings use_crc = FrameBase::no_crc) {
+        size_t n_frames = 0;
+        FrameHandle handle;
+
+        while (!queue->full()) {
+            receive_status status = tryReceive(pool, &handle, use_crc);
+            if (status == frame_ready) {
+                queue->push(handle);
+                n_frames++;
+            } else if (status == need_more_bytes) {
+                break;
+            }
+        }
+
+        return n_frames;
+    }
 
  private:
-    uint8_t can_frame_buffer[19] = {};  /**< Buffer for the CAN frame. */
-    HardwareSerial* _streamRef;        /**< Pointer to the HardwareSerial object. */
-    fault_reason _fault_reason = none; /**< Reason for a fault in the SerialCAN class. */
+    /**
+     * Serializes a CAN frame into the given buffer and advances the frame counter.
+     * @param outgoing_frame The outgoing CAN frame to be serialized.
+     * @param timestamp The timestamp of the CAN frame.
+     * @param buffer Destination with room for at least max_frame_size bytes.
+     * @return The number of bytes written to buffer.
+     */
+    size_t encodeFrame_(FrameT *outgoing_frame, uint32_t timestamp, uint8_t *buffer);
+
+    /**
+     * Serializes a CAN frame with a compact header, see setHeaderFormat().
+     * @param outgoing_frame The outgoing CAN frame to be serialized.
+     * @param timestamp The timestamp of the CAN frame.
+     * @param buffer Destination with room for at least max_frame_size bytes.
+     * @return The number of bytes written to buffer.
+     */
+    size_t encodeCompactFrame_(FrameT *outgoing_frame, uint32_t timestamp, uint8_t *buffer);
+
+    /**
+     * Serializes a CAN frame into a super-packet record and advances the frame counter.
+     * @param outgoing_frame The outgoing CAN frame to be serialized.
+     * @param timestamp_delta The timestamp relative to the packet base timestamp.
+     * @param buffer Destination with room for at least max_record_size bytes.
+     * @return The number of bytes written to buffer.
+     */
+    size_t encodeRecord_(FrameT *outgoing_frame, uint16_t timestamp_delta, uint8_t *buffer);
+
+    /**
+     * Pads the payload to a valid size and adds the counter and CRC if enabled.
+     * @param outgoing_frame The outgoing CAN frame.
+     * @return The serial DLC byte, including the frame flags.
+     * @pre Frames with use_crc set to crc8 have a dlc of at least 2.
+     */
+    uint8_t prepareFrame_(FrameT *outgoing_frame);
+
+    /**
+     * Gets the offset at which the outgoing data has to be serialized, leaving room for
+     * the COBS overhead so that it can be encoded in place.
+     * @param capacity The maximum size of the serialized data.
+     * @return The offset in bytes.
+     */
+    size_t framingOffset_(size_t capacity) {
+        return _framing == cobs_framing ? cobsMaxOverhead(capacity) : 0;
+    }
+
+    /**
+     * Applies the framing to data serialized at buffer + offset.
+     * @param buffer Destination of the framed data.
+     * @param offset The offset returned by framingOffset_().
+     * @param length The length of the serialized data.
+     * @return The length of the framed data at buffer.
+     */
+    size_t applyFraming_(uint8_t *buffer, size_t offset, size_t length);
+
+    /**
+     * Writes all queued bytes, blocking if necessary, so that frames sent with send(),
+     * sendBatch() or sendPacket() are not overtaken by queued frames.
+     */
+    void drainTxQueue_();
+
+    /**
+     * Writes up to n_bytes queued bytes.
+     * @param n_bytes The maximum number of bytes to write.
+     * @return The number of bytes written.
+     */
+    size_t writeTxQueue_(size_t n_bytes);
+
+    /**
+     * Checks if a byte starts a frame, a compact header frame if compact headers are enabled
+     * or a super-packet if packets are enabled.
+     * @param data_byte The byte to check.
+     * @return True if the byte is a start byte.
+     */
+    bool isStartByte_(uint8_t data_byte) {
+        return data_byte == FRAME_START_BYTE ||
+            (data_byte == COMPACT_START_BYTE && _rx_compact_headers) ||
+            (data_byte == PACKET_START_BYTE && _rx_window != _rx_buffer);
+    }
+
+    /**
+     * Gets the next byte to parse, from the rescanned window first and then from the stream.
+     * @param data_byte The byte to be populated.
+     * @return True if a byte was available.
+     */
+    bool nextByte_(uint8_t *data_byte);
+
+    /**
+     * Gets the payload size announced by a serial DLC byte.
+     * @param dlc_byte The DLC byte, including the frame flags.
+     * @return The payload size in bytes, or a value above MaxDLC if the DLC byte is invalid.
+     */
+    static size_t payloadLength_(uint8_t dlc_byte);
+
+    /**
+     * Gets the header, payload and frame size of the incoming frame from its DLC byte.
+     * @return True if the DLC byte is valid.
+     */
+    bool parseDlc_();
+
+    /**
+     * Gets the arbitration ID from the header of the incoming frame.
+     * @return The arbitration ID.
+     */
+    uint32_t decodeId_();
+
+    /**
+     * Gets the timestamp from the header of the incoming frame, resolving compact delta
+     * timestamps against the previous compact header frame.
+     * @return The timestamp.
+     */
+    uint32_t decodeTimestamp_();
+
+    /**
+     * Drops the start byte of the discarded frame in the receive buffer and schedules
+     * the rest of the buffered bytes to be rescanned for the next frame start.
+     */
+    void resync_();
+
+    /**
+     * Decodes the complete frame held in the receive buffer.
+     * @param incoming_frame The incoming CAN frame to be populated.
+     * @return frame_ready if the frame was decoded, frame_error otherwise.
+     */
+    receive_status decodeFrame_(FrameT *incoming_frame);
+
+    /**
+     * Checks the counter and CRC of a decoded frame if enabled, and tracks the counter if
+     * a sequence tracker is set.
+     * @param incoming_frame The decoded CAN frame.
+     * @return frame_ready if the CRC matches or is not used, frame_error otherwise.
+     */
+    receive_status checkCRC_(FrameT *incoming_frame);
+
+    /**
+     * Tracks the record boundaries of the super-packet being received and checks the
+     * packet once it is complete.
+     * @return frame_ready if a complete packet was checked, need_more_bytes if the packet
+     *         is not complete yet, or frame_error if the packet was discarded.
+     */
+    receive_status parsePacket_();
+
+    /**
+     * Decodes the next frame record of the received super-packet that passes the filters.
+     * @param incoming_frame The incoming CAN frame to be populated.
+     * @return frame_ready or frame_error for a decoded frame, or need_more_bytes if no
+     *         records are left.
+     */
+    receive_status unpackFrame_(FrameT *incoming_frame);
+
+    /**
+     * Parses the available bytes for the next frame, see tryReceive(), which adds the
+     * link statistics.
+     * @param incoming_frame The incoming CAN frame to be populated.
+     * @return The result of tryReceive().
+     */
+    receive_status parseFrame_(FrameT *incoming_frame);
+
+    /**
+     * Writes to the stream and counts the written bytes in the link statistics.
+     * @param buffer The bytes to write.
+     * @param length The number of bytes to write.
+     * @return The number of bytes written.
+     */
+    size_t write_(const uint8_t *buffer, size_t length) {
+        size_t written = _streamRef->write(buffer, length);
+#if SERIALCAN_STATISTICS
+        _statistics.bytes_sent += written;
+#endif
+        return written;
+    }
+
+    uint8_t can_frame_buffer[max_wire_size] = {};  /**< Buffer for the outgoing frame. */
+    uint8_t _rx_buffer[max_frame_size] = {};  /**< Buffer for the incoming frame. */
+    uint8_t *_rx_window = _rx_buffer;  /**< Receive buffer in use, frame or packet buffer. */
+    size_t _rx_window_size = max_frame_size;  /**< Size of the receive buffer in use. */
+    size_t _rx_length = 0;             /**< Number of bytes of the incoming frame received. */
+    size_t _rx_header_length = 0;      /**< Header size of the incoming frame. */
+    size_t _rx_payload_length = 0;     /**< Payload size of the incoming frame. */
+    size_t _rx_frame_length = 0;       /**< Total size of the incoming frame. */
+    uint32_t _rx_last_timestamp = 0;   /**< Timestamp of the last compact header frame. */
+    size_t _rx_replay_pos = 0;         /**< Next buffered byte to rescan after a discarded frame. */
+    size_t _rx_replay_end = 0;         /**< End of the buffered bytes to rescan. */
+    bool _rx_rejected = false;         /**< Incoming frame was rejected by the filters. */
+    size_t _rx_packet_records = 0;     /**< Records of the incoming packet not yet parsed. */
+    size_t _rx_packet_end = 0;         /**< End of the parsed records of the incoming packet. */
+    size_t _rx_unpack_pos = 0;         /**< Next record of the received packet to unpack. */
+    size_t _rx_unpack_count = 0;       /**< Records of the received packet left to unpack. */
+    uint8_t *_tx_queue = nullptr;      /**< Transmit byte queue used by trySend(). */
+    size_t _tx_queue_size = 0;         /**< Size of the transmit byte queue. */
+    size_t _tx_queue_head = 0;         /**< Position of the oldest queued byte. */
+    size_t _tx_queue_length = 0;       /**< Number of queued bytes. */
+    CobsDecoder _cobs_decoder;         /**< Decoder for COBS framing. */
+    bool _cobs_skip = false;           /**< Skip the rest of the current COBS block. */
+    StreamT* _streamRef;               /**< Pointer to the stream object. */
     bool _has_begun = false;           /**< Flag indicating if SerialCAN has been initialized. */
+    Dispatcher *_dispatcher = nullptr; /**< Handler table used by dispatch(). */
+    bool _rx_raw = false;              /**< Leave standard layout frames undecoded. */
+    const uint8_t *_rx_raw_frame = nullptr;  /**< Last frame left undecoded. */
 };
 
-constexpr uint8_t crcTable[256] = {
-    // CRC8 lookup table
-    0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15,
-    0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
-    0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65,
-    0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
-    0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5,
-    0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
-    0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85,
-    0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
-    0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2,
-    0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
-    0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2,
-    0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
-    0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32,
-    0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
-    0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42,
-    0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
-    0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c,
-    0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
-    0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec,
-    0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
-    0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c,
-    0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
-    0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c,
-    0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
-    0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b,
-    0x76, 0x71, 0x78, 0x7f, 0x6a, 0x6d, 0x64, 0x63,
-    0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b,
-    0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
-    0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb,
-    0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
-    0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb,
-    0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
-};
+/**
+ * SerialCAN over a HardwareSerial port.
+ */
+using SerialCAN = BasicSerialCAN<HardwareSerial>;
+
+/**
+ * SerialCAN with CAN FD frames over a HardwareSerial port.
+ */
+using SerialCANFD = BasicSerialCAN<HardwareSerial, MAX_FD_DLC>;
+
+#if SERIALCAN_ARDUINO
+extern template class BasicSerialCAN<HardwareSerial>;
+#endif
 
 }  // namespace serial_can
 
+#include "SerialCANImpl.hpp"
+
 #endif  // SERIALCAN_SRC_SERIALCAN_H_
@@ -0,0 +1,205 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_SERIALCANGATEWAY_HPP_
+#define SERIALCAN_SRC_SERIALCANGATEWAY_HPP_
+
+#include "SerialCAN.h"
+
+namespace serial_can {
+
+/**
+ * Routing table entry of a SerialCANGateway.
+ * A frame received on one of the source ports matches if (arbitration_id & mask) ==
+ * (id & mask), and is then sent to the destination ports with the ID bits selected by
+ * translate_mask replaced by those of translate_id.
+ */
+struct GatewayRoute {
+    uint32_t id;                /**< The arbitration ID to match. */
+    uint32_t mask;              /**< The ID bits that have to match. */
+    uint8_t source_ports;       /**< Bit set of the ports the route applies to. */
+    uint8_t destination_ports;  /**< Bit set of the ports the frames are sent to. */
+    uint32_t translate_mask;    /**< The ID bits to replace, 0 to keep the ID. */
+    uint32_t translate_id;      /**< The replacement ID bits. */
+};
+
+/**
+ * Forwarding counters and timing of a SerialCANGateway.
+ */
+struct GatewayStatistics {
+    uint32_t forwarded_frames;  /**< Frames sent to at least one port. */
+    uint32_t unrouted_frames;   /**< Frames without a matching route. */
+    uint32_t sent_frames;       /**< Frames written to destination ports. */
+    uint32_t frame_errors;      /**< Frames discarded by the receivers. */
+    uint32_t last_forward_us;   /**< Time spent on the last forwarded frame. */
+    uint32_t max_forward_us;    /**< Longest time spent on a forwarded frame. */
+    uint32_t total_forward_us;  /**< Time spent on all forwarded frames. */
+};
+
+/**
+ * Gateway that routes frames between several SerialCAN ports with a static routing table.
+ * Frames in the standard layout are forwarded from the receive buffer of the source port
+ * to the destination ports without being decoded into a frame and encoded again, see
+ * BasicSerialCAN::tryReceiveRaw() and BasicSerialCAN::sendRaw().
+ *
+ * The time spent per forwarded frame, from parsing its bytes to the last write, is
+ * measured with micros() and reported by getStatistics().
+ *
+ * @tparam NPorts The number of ports, no more than 8.
+ * @tparam SerialCANT The SerialCAN type of the ports.
+ */
+template<size_t NPorts, typename SerialCANT = SerialCAN>
+class SerialCANGateway {
+    static_assert(NPorts > 0 && NPorts <= 8, "SerialCANGateway supports 1 to 8 ports");
+
+ public:
+    /**
+     * Type of the forwarded frames.
+     */
+    typedef typename SerialCANT::FrameT FrameT;
+
+    /**
+     * Constructor for SerialCANGateway class.
+     * @param ports Array of NPorts SerialCAN objects, port i is bit i in the routes.
+     * @param routes The routing table, checked in order, the first matching route is used.
+     *               It is referenced, not copied, and must outlive the gateway.
+     * @param n_routes The number of routes in the table.
+     */
+    SerialCANGateway(SerialCANT *const ports[NPorts], const GatewayRoute *routes,
+        size_t n_routes) : _routes{routes}, _n_routes{n_routes} {
+        for (size_t i = 0; i < NPorts; i++) {
+            _ports[i] = ports[i];
+        }
+    }
+
+    /**
+     * Forwards the frames that have been received on all ports.
+     * @param max_frames_per_port The maximum number of frames to take from each port, so
+     *                            that a busy port cannot starve the others.
+     * @return The number of frames forwarded.
+     */
+    size_t poll(size_t max_frames_per_port = 8) {
+        size_t n_frames = 0;
+
+        for (size_t port = 0; port < NPorts; port++) {
+            for (size_t i = 0; i < max_frames_per_port; i++) {
+                uint32_t start_us = micros();
+                const uint8_t *raw_frame;
+
+                SerialCANBase::receive_status status =
+                    _ports[port]->tryReceiveRaw(&_frame, &raw_frame);
+                if (status == SerialCANBase::need_more_bytes) {
+                    break;
+                }
+                if (status == SerialCANBase::frame_error) {
+                    _statistics.frame_errors++;
+                    continue;
+                }
+
+                if (forward_(port, raw_frame)) {
+                    uint32_t forward_us = micros() - start_us;
+                    _statistics.last_forward_us = forward_us;
+                    _statistics.total_forward_us += forward_us;
+                    if (forward_us > _statistics.max_forward_us) {
+                        _statistics.max_forward_us = forward_us;
+                    }
+                    n_frames++;
+                }
+            }
+        }
+
+        return n_frames;
+    }
+
+    /**
+     * Get the forwarding counters and timing.
+     * @return The statistics.
+     */
+    const GatewayStatistics &getStatistics() const { return _statistics; }
+
+    /**
+     * Resets the forwarding counters and timing.
+     */
+    void resetStatistics() { _statistics = GatewayStatistics(); }
+
+ private:
+    /**
+     * Sends a received frame to the destination ports of the first matching route.
+     * @param source_port The port the frame was received on.
+     * @param raw_frame The serialized frame, or nullptr if it was decoded into _frame.
+     * @return True if the frame was sent to at least one port.
+     */
+    bool forward_(size_t source_port, const uint8_t *raw_frame) {
+        uint32_t arbitration_id = _frame.arbitration_id;
+
+        for (size_t r = 0; r < _n_routes; r++) {
+            const GatewayRoute &route = _routes[r];
+            if (!(route.source_ports & (1 << source_port)) ||
+                (arbitration_id & route.mask) != (route.id & route.mask)) {
+                continue;
+            }
+
+            uint32_t translated_id = (arbitration_id & ~route.translate_mask) |
+                (route.translate_id & route.translate_mask);
+            // Frames are never sent back to the port they came from
+            uint8_t destinations = route.destination_ports & ~(1 << source_port);
+            if (destinations == 0) {
+                break;
+            }
+
+            for (size_t port = 0; port < NPorts; port++) {
+                if (!(destinations & (1 << port))) {
+                    continue;
+                }
+
+                if (raw_frame != nullptr) {
+                    _ports[port]->sendRaw(raw_frame, translated_id);
+                } else {
+                    // Without CRC settings the counter and CRC bytes are copied as is
+                    _frame.arbitration_id = translated_id;
+                    _ports[port]->send(&_frame, _frame.timestamp);
+                }
+                _statistics.sent_frames++;
+            }
+
+            _statistics.forwarded_frames++;
+            return true;
+        }
+
+        _statistics.unrouted_frames++;
+        return false;
+    }
+
+    SerialCANT *_ports[NPorts];         /**< The ports, indexed by port number. */
+    const GatewayRoute *_routes;        /**< The routing table. */
+    size_t _n_routes;                   /**< The number of routes. */
+    FrameT _frame;                      /**< Header, or whole frame, of the received frame. */
+    GatewayStatistics _statistics = {}; /**< Forwarding counters and timing. */
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_SERIALCANGATEWAY_HPP_
@@ -0,0 +1,970 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_SERIALCANIMPL_HPP_
+#define SERIALCAN_SRC_SERIALCANIMPL_HPP_
+
+#include "SerialCAN.h"
+
+namespace serial_can {
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::begin(uint32_t baud_rate) {
+    _streamRef->begin(baud_rate);
+    _has_begun = true;
+#if SERIALCAN_STATISTICS_TIMING
+    beginStatisticsClock();
+#endif
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::send(FrameT *outgoing_frame, uint32_t timestamp) {
+    // Check if SerialCAN has not been initialized with begin().
+    assert(_has_begun);
+#if SERIALCAN_STATISTICS_TIMING
+    uint32_t start_ticks = SERIALCAN_STATISTICS_CLOCK();
+#endif
+
+    drainTxQueue_();
+
+    // Send Frame
+    size_t offset = framingOffset_(max_frame_size);
+    size_t frame_length = encodeFrame_(outgoing_frame, timestamp, &can_frame_buffer[offset]);
+    frame_length = applyFraming_(can_frame_buffer, offset, frame_length);
+    write_(can_frame_buffer, frame_length);
+    countSentFrames_(1);
+
+#if SERIALCAN_STATISTICS_TIMING
+    uint32_t ticks = SERIALCAN_STATISTICS_CLOCK() - start_ticks;
+    if (ticks > _statistics.max_send_ticks) {
+        _statistics.max_send_ticks = ticks;
+    }
+#endif
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::sendBatch(
+    FrameT *outgoing_frames, size_t n_frames, uint32_t timestamp) {
+    // Check if SerialCAN has not been initialized with begin().
+    assert(_has_begun);
+
+    drainTxQueue_();
+
+    uint8_t batch_buffer[SERIALCAN_TX_BATCH_BUFFER_SIZE > max_wire_size ?
+        SERIALCAN_TX_BATCH_BUFFER_SIZE : max_wire_size];
+    size_t batch_length = 0;
+    size_t offset = framingOffset_(max_frame_size);
+
+    for (size_t i = 0; i < n_frames; i++) {
+        // Flush the batch if the next frame may not fit
+        if (batch_length + max_wire_size > sizeof(batch_buffer)) {
+            write_(batch_buffer, batch_length);
+            batch_length = 0;
+        }
+
+        size_t frame_length = encodeFrame_(
+            &outgoing_frames[i], timestamp, &batch_buffer[batch_length + offset]);
+        batch_length += applyFraming_(&batch_buffer[batch_length], offset, frame_length);
+    }
+
+    if (batch_length > 0) {
+        write_(batch_buffer, batch_length);
+    }
+    countSentFrames_(n_frames);
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::sendPacket(FrameT *outgoing_frames, size_t n_frames) {
+    // Check if SerialCAN has not been initialized with begin().
+    assert(_has_begun);
+
+    drainTxQueue_();
+
+    uint8_t packet_buffer[SERIALCAN_TX_BATCH_BUFFER_SIZE > min_packet_size + 2 ?
+        SERIALCAN_TX_BATCH_BUFFER_SIZE : min_packet_size + 2];
+
+    // Leave room for the COBS overhead and delimiter
+    size_t offset = framingOffset_(sizeof(packet_buffer));
+    size_t packet_capacity = sizeof(packet_buffer) - offset - (offset > 0 ? 1 : 0);
+    uint8_t *packet = &packet_buffer[offset];
+    size_t i = 0;
+
+    while (i < n_frames) {
+        uint32_t base_timestamp = outgoing_frames[i].timestamp;
+        size_t packet_length = PACKET_HEADER_SIZE;
+        uint8_t n_records = 0;
+
+        // Add frames while they fit and their timestamp delta fits in 16 bits
+        while (i < n_frames && n_records < 0xFF &&
+            packet_length + max_record_size + 2 <= packet_capacity &&
+            outgoing_frames[i].timestamp - base_timestamp <= 0xFFFF) {
+            packet_length += encodeRecord_(&outgoing_frames[i],
+                outgoing_frames[i].timestamp - base_timestamp, &packet[packet_length]);
+            n_records++;
+            i++;
+        }
+
+        // Packet header
+        packet[0] = PACKET_START_BYTE;
+        packet[1] = n_records;
+        for (int j = 0; j < 4; j++) {
+            packet[j+2] = base_timestamp >> (j * 8);
+        }
+
+        // One CRC covers the record count, base timestamp and all records
+        packet[packet_length] = getCRC8(&packet[1], packet_length - 1);
+        packet[packet_length + 1] = FRAME_END_BYTE;
+
+        packet_length = applyFraming_(packet_buffer, offset, packet_length + 2);
+        write_(packet_buffer, packet_length);
+    }
+    countSentFrames_(n_frames);
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::enablePackets(uint8_t *buffer, size_t size) {
+    assert(size >= min_packet_size);
+
+    _rx_window = buffer;
+    _rx_window_size = size;
+    _rx_length = 0;
+    _rx_replay_pos = 0;
+    _rx_replay_end = 0;
+    _rx_unpack_count = 0;
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::setFraming(framing mode) {
+    _framing = mode;
+    _rx_length = 0;
+    _rx_replay_pos = 0;
+    _rx_replay_end = 0;
+    _cobs_decoder.reset();
+    _cobs_skip = false;
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::enableTxQueue(uint8_t *buffer, size_t size) {
+    assert(size >= max_wire_size);
+
+    drainTxQueue_();
+    _tx_queue = buffer;
+    _tx_queue_size = size;
+}
+
+template<typename StreamT, size_t MaxDLC>
+bool BasicSerialCAN<StreamT, MaxDLC>::trySend(FrameT *outgoing_frame, uint32_t timestamp) {
+    // Check if SerialCAN has not been initialized with begin().
+    assert(_has_begun);
+    assert(_tx_queue != nullptr);
+#if SERIALCAN_STATISTICS_TIMING
+    uint32_t start_ticks = SERIALCAN_STATISTICS_CLOCK();
+#endif
+
+    // Encoding writes the counter, CRC and padding into the payload and advances the frame
+    // counter and the compact header state, so a copy is encoded until the frame fits
+    FrameT encoded_frame = *outgoing_frame;
+    uint32_t last_timestamp = _tx_last_timestamp;
+    uint8_t sync_countdown = _tx_sync_countdown;
+
+    size_t offset = framingOffset_(max_frame_size);
+    size_t frame_length = encodeFrame_(&encoded_frame, timestamp, &can_frame_buffer[offset]);
+    frame_length = applyFraming_(can_frame_buffer, offset, frame_length);
+
+    // Reject the frame as if it was never encoded
+    if (frame_length > _tx_queue_size - _tx_queue_length) {
+        _tx_last_timestamp = last_timestamp;
+        _tx_sync_countdown = sync_countdown;
+        return false;
+    }
+    *outgoing_frame = encoded_frame;
+
+    // Copy into the queue, in two parts if it wraps around
+    size_t tail = _tx_queue_head + _tx_queue_length;
+    tail = tail < _tx_queue_size ? tail : tail - _tx_queue_size;
+    size_t first_part = _tx_queue_size - tail < frame_length ?
+        _tx_queue_size - tail : frame_length;
+    memcpy(&_tx_queue[tail], can_frame_buffer, first_part);
+    memcpy(_tx_queue, &can_frame_buffer[first_part], frame_length - first_part);
+    _tx_queue_length += frame_length;
+    countSentFrames_(1);
+
+    flushSome();
+
+#if SERIALCAN_STATISTICS_TIMING
+    uint32_t ticks = SERIALCAN_STATISTICS_CLOCK() - start_ticks;
+    if (ticks > _statistics.max_send_ticks) {
+        _statistics.max_send_ticks = ticks;
+    }
+#endif
+    return true;
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::flushSome() {
+    int writable = _streamRef->availableForWrite();
+    if (writable <= 0) {
+        return 0;
+    }
+    return writeTxQueue_(static_cast<size_t>(writable));
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::drainTxQueue_() {
+    if (_tx_queue_length > 0) {
+        writeTxQueue_(_tx_queue_length);
+    }
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::writeTxQueue_(size_t n_bytes) {
+    size_t n_written = 0;
+    n_bytes = n_bytes < _tx_queue_length ? n_bytes : _tx_queue_length;
+
+    // At most two writes, the second one if the queued bytes wrap around
+    while (n_written < n_bytes) {
+        size_t chunk = _tx_queue_size - _tx_queue_head;
+        chunk = chunk < n_bytes - n_written ? chunk : n_bytes - n_written;
+
+        size_t written = write_(&_tx_queue[_tx_queue_head], chunk);
+        _tx_queue_head += written;
+        _tx_queue_head = _tx_queue_head < _tx_queue_size ? _tx_queue_head : 0;
+        _tx_queue_length -= written;
+        n_written += written;
+
+        if (written < chunk) {
+            break;
+        }
+    }
+
+    return n_written;
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::applyFraming_(
+    uint8_t *buffer, size_t offset, size_t length) {
+    if (_framing != cobs_framing) {
+        return length;
+    }
+
+    // Encoded in place, the data starts far enough behind buffer
+    length = cobsEncode(&buffer[offset], length, buffer);
+    buffer[length] = 0x00;
+    return length + 1;
+}
+
+template<typename StreamT, size_t MaxDLC>
+uint8_t BasicSerialCAN<StreamT, MaxDLC>::prepareFrame_(FrameT *outgoing_frame) {
+    // Round the payload up to the next size that a DLC code can carry
+    uint8_t dlc_code = FrameBase::lengthToDlc(outgoing_frame->dlc);
+    uint8_t length = FrameBase::dlcToLength(dlc_code);
+    for (uint8_t i = outgoing_frame->dlc; i < length; i++) {
+        outgoing_frame->payload[i] = 0;
+    }
+
+    // Payloads above 8 bytes are only valid in CAN FD frames
+    uint8_t flags = outgoing_frame->flags & (FrameBase::fd_frame | FrameBase::bitrate_switch);
+    if (length > MAX_DLC) {
+        flags |= FrameBase::fd_frame;
+    }
+    if (!(flags & FrameBase::fd_frame)) {
+        flags = 0;
+    }
+
+    // Calculate CRC if use_crc is FrameBase::crc8
+    if (outgoing_frame->use_crc == FrameBase::crc8) {
+        // Room is needed for the counter and CRC bytes, the frame is sent without them
+        // if asserts are disabled
+        assert(length >= 2);
+        if (length < 2) {
+            return flags | dlc_code;
+        }
+
+        // Set counter in next last byte in payload
+        outgoing_frame->payload[length-2] = outgoing_frame->counter;
+
+        // Calculate CRC and put in last byte in payload
+        outgoing_frame->payload[length-1] = getCRC8(outgoing_frame->payload, length-1);
+    }
+
+    return flags | dlc_code;
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::encodeFrame_(
+    FrameT *outgoing_frame, uint32_t timestamp, uint8_t *buffer) {
+    if (_header_format == compact_header) {
+        return encodeCompactFrame_(outgoing_frame, timestamp, buffer);
+    }
+
+    uint8_t dlc_byte = prepareFrame_(outgoing_frame);
+    uint8_t length = FrameBase::dlcToLength(dlc_byte & 0x0F);
+
+    // Start byte
+    buffer[0] = FRAME_START_BYTE;
+
+    // Timestamp
+    for (int i = 0; i < 4; i++) {
+        buffer[i+1] = timestamp >> (i * 8);
+    }
+
+    // DLC, with the CAN FD flags in the upper bits
+    buffer[5] = dlc_byte;
+
+    // Arbitration ID
+    for (int i = 0; i < 4; i++) {
+        buffer[i+6] = outgoing_frame->arbitration_id >> (i * 8);
+    }
+
+    // Payload
+    for (int i = 0; i < length; i++) {
+        buffer[FRAME_HEADER_SIZE + i] = outgoing_frame->payload[i];
+    }
+
+    // End byte
+    buffer[FRAME_HEADER_SIZE + length] = FRAME_END_BYTE;
+
+    outgoing_frame->counter++;
+
+    return FRAME_HEADER_SIZE + length + 1;
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::encodeCompactFrame_(
+    FrameT *outgoing_frame, uint32_t timestamp, uint8_t *buffer) {
+    uint8_t dlc_byte = prepareFrame_(outgoing_frame);
+    uint8_t length = FrameBase::dlcToLength(dlc_byte & 0x0F);
+
+    // Smallest timestamp width, with an absolute timestamp every sync interval
+    uint32_t timestamp_value = timestamp - _tx_last_timestamp;
+    uint8_t timestamp_code = 2;
+    if (_tx_sync_countdown > 0 && timestamp_value <= 0xFF) {
+        timestamp_code = 0;
+    } else if (_tx_sync_countdown > 0 && timestamp_value <= 0xFFFF) {
+        timestamp_code = 1;
+    }
+
+    if (timestamp_code == 2) {
+        timestamp_value = timestamp;
+        _tx_sync_countdown = SERIALCAN_COMPACT_SYNC_INTERVAL;
+    } else {
+        _tx_sync_countdown--;
+    }
+    _tx_last_timestamp = timestamp;
+
+    size_t timestamp_length = 1 << timestamp_code;
+    size_t id_length = outgoing_frame->arbitration_id > 0x7FF ? 4 : 2;
+
+    // Start byte
+    buffer[0] = COMPACT_START_BYTE;
+
+    // Flags
+    buffer[1] = (dlc_byte & (FrameBase::fd_frame | 0x0F)) |
+        (timestamp_code << COMPACT_TIMESTAMP_SHIFT) | (id_length == 4 ? COMPACT_LONG_ID_FLAG : 0);
+
+    // Timestamp
+    for (size_t i = 0; i < timestamp_length; i++) {
+        buffer[i+2] = timestamp_value >> (i * 8);
+    }
+
+    // Arbitration ID
+    uint8_t *data = &buffer[2 + timestamp_length];
+    for (size_t i = 0; i < id_length; i++) {
+        data[i] = outgoing_frame->arbitration_id >> (i * 8);
+    }
+
+    // Payload
+    memcpy(&data[id_length], outgoing_frame->payload, length);
+
+    // End byte
+    data[id_length + length] = FRAME_END_BYTE;
+
+    outgoing_frame->counter++;
+
+    return 2 + timestamp_length + id_length + length + 1;
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::encodeRecord_(
+    FrameT *outgoing_frame, uint16_t timestamp_delta, uint8_t *buffer) {
+    uint8_t dlc_byte = prepareFrame_(outgoing_frame);
+    uint8_t length = FrameBase::dlcToLength(dlc_byte & 0x0F);
+    size_t id_length = outgoing_frame->arbitration_id > 0xFFFF ? 4 : 2;
+
+    // DLC, flagging arbitration IDs that need 4 bytes
+    buffer[0] = dlc_byte | (id_length == 4 ? PACKET_LONG_ID_FLAG : 0);
+
+    // Timestamp relative to the packet base timestamp
+    buffer[1] = timestamp_delta;
+    buffer[2] = timestamp_delta >> 8;
+
+    // Arbitration ID
+    for (size_t i = 0; i < id_length; i++) {
+        buffer[i+3] = outgoing_frame->arbitration_id >> (i * 8);
+    }
+
+    // Payload
+    memcpy(&buffer[3 + id_length], outgoing_frame->payload, length);
+
+    outgoing_frame->counter++;
+
+    return 3 + id_length + length;
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::payloadLength_(uint8_t dlc_byte) {
+    uint8_t flags = dlc_byte & 0xF0;
+    uint8_t dlc_code = dlc_byte & 0x0F;
+
+    // Bits 4 and 5 are reserved
+    if (flags & ~(FrameBase::fd_frame | FrameBase::bitrate_switch)) {
+        return MaxDLC + 1;
+    }
+
+    // Classic frames carry at most 8 bytes and cannot switch bit rate
+    if (!(flags & FrameBase::fd_frame) &&
+        (dlc_code > MAX_DLC || (flags & FrameBase::bitrate_switch))) {
+        return MaxDLC + 1;
+    }
+
+    return FrameBase::dlcToLength(dlc_code);
+}
+
+
+template<typename StreamT, size_t MaxDLC>
+bool BasicSerialCAN<StreamT, MaxDLC>::receive(FrameT *incoming_frame, uint32_t timeout_ms) {
+    uint32_t time_since_byte = millis();
+#if SERIALCAN_STATISTICS
+    uint32_t start_ms = time_since_byte;
+#endif
+
+    for (;;) {
+        size_t received_bytes = _rx_length;
+
+        switch (tryReceive(incoming_frame)) {
+            case frame_ready: {
+#if SERIALCAN_STATISTICS
+                uint32_t wait_ms = millis() - start_ms;
+                if (wait_ms > _statistics.max_rx_wait_ms) {
+                    _statistics.max_rx_wait_ms = wait_ms;
+                }
+#endif
+                return true;
+            }
+            case frame_error:
+                return false;
+            default:
+                break;
+        }
+
+        // Nothing has arrived that could start a frame
+        if (_rx_length == 0) {
+            _fault_reason = no_incoming_data;
+            countFault_();
+            return false;
+        }
+
+        // Wait for the rest of the frame
+        if (_rx_length != received_bytes) {
+            time_since_byte = millis();
+        } else if (millis() - time_since_byte > timeout_ms) {
+            _rx_length = 0;
+            _fault_reason = timeout;
+            countFault_();
+            return false;
+        }
+    }
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::tryReceive(
+    FrameT *incoming_frame) {
+#if SERIALCAN_STATISTICS_TIMING
+    uint32_t start_ticks = SERIALCAN_STATISTICS_CLOCK();
+#endif
+
+    receive_status status = parseFrame_(incoming_frame);
+
+#if SERIALCAN_STATISTICS
+    countFault_();
+    if (status == frame_ready) {
+        _statistics.frames_received++;
+#if SERIALCAN_STATISTICS_TIMING
+        uint32_t ticks = SERIALCAN_STATISTICS_CLOCK() - start_ticks;
+        if (ticks > _statistics.max_parse_ticks) {
+            _statistics.max_parse_ticks = ticks;
+        }
+        _statistics.parse_time_histogram[parseTimeBucket(ticks)]++;
+#endif
+    }
+#endif
+
+    return status;
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::parseFrame_(
+    FrameT *incoming_frame) {
+    uint8_t data_byte;
+    _fault_reason = none;
+
+    // Frames of a received packet are delivered before more bytes are parsed
+    if (_rx_unpack_count > 0) {
+        receive_status status = unpackFrame_(incoming_frame);
+        if (status != need_more_bytes) {
+            return status;
+        }
+    }
+
+    while (nextByte_(&data_byte)) {
+        // Undo the byte stuffing, a block ends with the frame it holds
+        if (_framing == cobs_framing) {
+            CobsDecoder::result result = _cobs_decoder.decode(data_byte, &data_byte);
+
+            if (result == CobsDecoder::end_of_block) {
+                bool truncated = _rx_length > 0;
+                _rx_length = 0;
+                _cobs_skip = false;
+                if (truncated) {
+                    _fault_reason = framing_error;
+                    return frame_error;
+                }
+                continue;
+            }
+
+            if (result == CobsDecoder::no_data || _cobs_skip) {
+                continue;
+            }
+
+            // A block that does not begin with a start byte holds no frame
+            if (_cobs_decoder.decoded() == 1 && !isStartByte_(data_byte)) {
+                _cobs_skip = true;
+                continue;
+            }
+        }
+
+        // Hunt for frame start byte, or packet start byte if packets are enabled
+        if (_rx_length == 0 && !isStartByte_(data_byte)) {
+#if SERIALCAN_STATISTICS
+            _statistics.discarded_bytes++;
+#endif
+            continue;
+        }
+
+        _rx_window[_rx_length++] = data_byte;
+
+        if (_rx_window[0] == PACKET_START_BYTE) {
+            receive_status status = parsePacket_();
+            if (status == frame_ready) {
+                status = unpackFrame_(incoming_frame);
+            }
+            if (status != need_more_bytes) {
+                return status;
+            }
+            continue;
+        }
+
+        // The DLC byte tells where the header and the frame end
+        if (_rx_length == 1) {
+            _rx_header_length = 0;
+            _rx_frame_length = 0;
+        } else if (_rx_length == (_rx_window[0] == COMPACT_START_BYTE ? 2 : 6) && !parseDlc_()) {
+            // A DLC above the maximum means this was not a frame start
+            _fault_reason = invalid_dlc;
+            resync_();
+            return frame_error;
+        }
+
+        // Check acceptance filters as soon as the arbitration ID is complete
+        if (_rx_length == _rx_header_length) {
+            _rx_rejected = _filter_bank.enabled() && !_filter_bank.accepts(decodeId_());
+        }
+
+        // Frame is complete once the byte after the payload has arrived
+        if (_rx_length == _rx_frame_length) {
+            // Drop rejected frames without decoding them, but keep the delta timestamps
+            if (_rx_rejected && _rx_window[_rx_length - 1] == FRAME_END_BYTE) {
+                decodeTimestamp_();
+                _rx_length = 0;
+                _rejected_frames++;
+                continue;
+            }
+
+            receive_status status = decodeFrame_(incoming_frame);
+            if (status == frame_error) {
+                resync_();
+            } else {
+                _rx_length = 0;
+            }
+            return status;
+        }
+    }
+
+    return need_more_bytes;
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::tryReceiveRaw(
+    FrameT *incoming_frame, const uint8_t **raw_frame) {
+    _rx_raw = true;
+    _rx_raw_frame = nullptr;
+    receive_status status = tryReceive(incoming_frame);
+    _rx_raw = false;
+
+    *raw_frame = _rx_raw_frame;
+    return status;
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::sendRaw(const uint8_t *raw_frame, uint32_t arbitration_id) {
+    // Check if SerialCAN has not been initialized with begin().
+    assert(_has_begun);
+
+    size_t payload_length = payloadLength_(raw_frame[5]);
+
+    // Compact headers have to be encoded from a frame
+    if (_header_format == compact_header) {
+        FrameT outgoing_frame{arbitration_id, static_cast<uint8_t>(payload_length)};
+        outgoing_frame.flags = raw_frame[5] & (FrameBase::fd_frame | FrameBase::bitrate_switch);
+        memcpy(outgoing_frame.payload, &raw_frame[FRAME_HEADER_SIZE], payload_length);
+
+        uint32_t timestamp = 0;
+        for (int i = 0; i < 4; i++) {
+            timestamp |= static_cast<uint32_t>(raw_frame[i+1]) << (i * 8);
+        }
+        send(&outgoing_frame, timestamp);
+        return;
+    }
+
+    drainTxQueue_();
+
+    size_t offset = framingOffset_(max_frame_size);
+    size_t frame_length = FRAME_HEADER_SIZE + payload_length + 1;
+    memcpy(&can_frame_buffer[offset], raw_frame, frame_length);
+    for (int i = 0; i < 4; i++) {
+        can_frame_buffer[offset + i + 6] = arbitration_id >> (i * 8);
+    }
+
+    frame_length = applyFraming_(can_frame_buffer, offset, frame_length);
+    write_(can_frame_buffer, frame_length);
+    countSentFrames_(1);
+}
+
+template<typename StreamT, size_t MaxDLC>
+size_t BasicSerialCAN<StreamT, MaxDLC>::dispatch(FrameBase::crc_settings use_crc) {
+    assert(_dispatcher != nullptr);
+
+    FrameT incoming_frame{use_crc};
+    size_t n_frames = 0;
+    receive_status status;
+
+    while ((status = tryReceive(&incoming_frame)) != need_more_bytes) {
+        if (status == frame_ready && _dispatcher->dispatch(&incoming_frame)) {
+            n_frames++;
+        }
+    }
+
+    return n_frames;
+}
+
+template<typename StreamT, size_t MaxDLC>
+bool BasicSerialCAN<StreamT, MaxDLC>::nextByte_(uint8_t *data_byte) {
+    if (_rx_replay_pos < _rx_replay_end) {
+        *data_byte = _rx_window[_rx_replay_pos++];
+        return true;
+    }
+
+    if (_streamRef->available() > 0) {
+        *data_byte = _streamRef->read();
+#if SERIALCAN_STATISTICS
+        _statistics.bytes_received++;
+#endif
+        return true;
+    }
+
+    return false;
+}
+
+template<typename StreamT, size_t MaxDLC>
+void BasicSerialCAN<StreamT, MaxDLC>::resync_() {
+    // Block boundaries are known with COBS framing, so the rest of the block is dropped
+    if (_framing == cobs_framing) {
+        _rx_length = 0;
+        _cobs_skip = true;
+        return;
+    }
+
+    // Bytes that were not parsed yet follow the discarded frame in the buffer. The
+    // frame is always written behind the rescan position, so the move never overlaps
+    // bytes that are still to be rescanned.
+    size_t pending = _rx_replay_end - _rx_replay_pos;
+    memmove(&_rx_window[_rx_length], &_rx_window[_rx_replay_pos], pending);
+
+    // Rescan everything after the start byte of the discarded frame
+    _rx_replay_pos = 1;
+    _rx_replay_end = _rx_length + pending;
+    _rx_length = 0;
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::decodeFrame_(
+    FrameT *incoming_frame) {
+    uint8_t dlc = _rx_payload_length;
+    size_t frame_length = _rx_length;
+
+    if (_rx_window[frame_length - 1] != FRAME_END_BYTE) {
+        _fault_reason = missing_end_delimeter;
+        return frame_error;
+    }
+
+    // Parse Header
+    incoming_frame->timestamp = decodeTimestamp_();
+    incoming_frame->arbitration_id = decodeId_();
+    incoming_frame->dlc = dlc;
+    if (_rx_window[0] == COMPACT_START_BYTE) {
+        incoming_frame->flags = _rx_window[1] & FrameBase::fd_frame;
+    } else {
+        incoming_frame->flags = _rx_window[5] & (FrameBase::fd_frame | FrameBase::bitrate_switch);
+
+        // Leave the payload in the receive buffer for sendRaw()
+        if (_rx_raw) {
+            _rx_raw_frame = _rx_window;
+            return frame_ready;
+        }
+    }
+
+    // Parse payload
+    for (int i = 0; i < dlc; i++) {
+        incoming_frame->payload[i] = _rx_window[_rx_header_length + i];
+    }
+
+    return checkCRC_(incoming_frame);
+}
+
+template<typename StreamT, size_t MaxDLC>
+bool BasicSerialCAN<StreamT, MaxDLC>::parseDlc_() {
+    if (_rx_window[0] == COMPACT_START_BYTE) {
+        uint8_t flags = _rx_window[1];
+        uint8_t timestamp_code = (flags >> COMPACT_TIMESTAMP_SHIFT) & 0x03;
+
+        // Timestamp width code 3 is reserved
+        if (timestamp_code == 3) {
+            return false;
+        }
+
+        _rx_payload_length = payloadLength_(flags & (FrameBase::fd_frame | 0x0F));
+        _rx_header_length = 2 + (1 << timestamp_code) + (flags & COMPACT_LONG_ID_FLAG ? 4 : 2);
+    } else {
+        _rx_payload_length = payloadLength_(_rx_window[5]);
+        _rx_header_length = FRAME_HEADER_SIZE;
+    }
+
+    _rx_frame_length = _rx_header_length + _rx_payload_length + 1;
+    return _rx_payload_length <= MaxDLC;
+}
+
+template<typename StreamT, size_t MaxDLC>
+uint32_t BasicSerialCAN<StreamT, MaxDLC>::decodeId_() {
+    size_t id_pos = 6;
+    size_t id_length = 4;
+    if (_rx_window[0] == COMPACT_START_BYTE) {
+        id_length = _rx_window[1] & COMPACT_LONG_ID_FLAG ? 4 : 2;
+        id_pos = _rx_header_length - id_length;
+    }
+
+    uint32_t arbitration_id = 0;
+    for (size_t i = 0; i < id_length; i++) {
+        arbitration_id |= static_cast<uint32_t>(_rx_window[id_pos + i]) << (i * 8);
+    }
+    return arbitration_id;
+}
+
+template<typename StreamT, size_t MaxDLC>
+uint32_t BasicSerialCAN<StreamT, MaxDLC>::decodeTimestamp_() {
+    uint32_t timestamp = 0;
+
+    if (_rx_window[0] != COMPACT_START_BYTE) {
+        for (int i = 0; i < 4; i++) {
+            timestamp |= static_cast<uint32_t>(_rx_window[i+1]) << (i * 8);
+        }
+        return timestamp;
+    }
+
+    uint8_t timestamp_code = (_rx_window[1] >> COMPACT_TIMESTAMP_SHIFT) & 0x03;
+    for (size_t i = 0; i < (1u << timestamp_code); i++) {
+        timestamp |= static_cast<uint32_t>(_rx_window[i+2]) << (i * 8);
+    }
+
+    // Delta timestamps are relative to the previous compact header frame
+    if (timestamp_code != 2) {
+        timestamp += _rx_last_timestamp;
+    }
+    _rx_last_timestamp = timestamp;
+    return timestamp;
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::checkCRC_(
+    FrameT *incoming_frame) {
+    // Check crc match if use_crc is FrameBase::crc8
+    if (incoming_frame->use_crc == FrameBase::crc8) {
+        // Room is needed for the counter and CRC bytes
+        if (incoming_frame->dlc < 2) {
+            _fault_reason = invalid_dlc;
+            return frame_error;
+        }
+
+        // Store counter
+        incoming_frame->counter = incoming_frame->payload[incoming_frame->dlc-2];
+
+        // Calculate CRC, excluding CRC byte in payload
+        uint8_t crc_value = getCRC8(incoming_frame->payload, incoming_frame->dlc-1);
+        incoming_frame->crc = crc_value;
+
+        // Check if CRC is a match between calculated and payload CRC
+        if (crc_value != incoming_frame->payload[incoming_frame->dlc-1]) {
+            _fault_reason = crc_mismatch;
+            return frame_error;
+        }
+
+        // Frames with a valid CRC are received even if their counter is unexpected
+        if (_sequence_tracker != nullptr) {
+            switch (_sequence_tracker->track(incoming_frame->arbitration_id,
+                                             incoming_frame->counter)) {
+                case SequenceTracker::sequence_lost:
+                    _fault_reason = frames_lost;
+                    break;
+                case SequenceTracker::sequence_repeated:
+                    _fault_reason = frame_repeated;
+                    break;
+                case SequenceTracker::sequence_out_of_order:
+                    _fault_reason = frame_out_of_order;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return frame_ready;
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::parsePacket_() {
+    size_t index = _rx_length - 1;
+
+    if (index == 1) {
+        // Record count
+        _rx_packet_records = _rx_window[1];
+        _rx_packet_end = PACKET_HEADER_SIZE;
+        if (_rx_packet_records == 0) {
+            _fault_reason = invalid_dlc;
+            resync_();
+            return frame_error;
+        }
+    } else if (_rx_packet_records > 0 && index == _rx_packet_end) {
+        // DLC byte of the next record, which tells where the record ends
+        uint8_t dlc_byte = _rx_window[index];
+        size_t payload_length = payloadLength_(dlc_byte & ~PACKET_LONG_ID_FLAG);
+        if (payload_length > MaxDLC) {
+            _fault_reason = invalid_dlc;
+            resync_();
+            return frame_error;
+        }
+
+        _rx_packet_end += 3 + (dlc_byte & PACKET_LONG_ID_FLAG ? 4 : 2) + payload_length;
+        _rx_packet_records--;
+
+        // The records, CRC and end byte have to fit in the receive window
+        if (_rx_packet_end + 2 > _rx_window_size) {
+            _fault_reason = packet_too_large;
+            resync_();
+            return frame_error;
+        }
+    } else if (_rx_packet_records == 0 && _rx_length == _rx_packet_end + 2) {
+        if (_rx_window[index] != FRAME_END_BYTE) {
+            _fault_reason = missing_end_delimeter;
+            resync_();
+            return frame_error;
+        }
+
+        if (getCRC8(&_rx_window[1], _rx_packet_end - 1) != _rx_window[_rx_packet_end]) {
+            _fault_reason = crc_mismatch;
+            resync_();
+            return frame_error;
+        }
+
+        // Records are unpacked in place, before the window is reused
+        _rx_unpack_pos = PACKET_HEADER_SIZE;
+        _rx_unpack_count = _rx_window[1];
+        _rx_length = 0;
+        return frame_ready;
+    }
+
+    return need_more_bytes;
+}
+
+template<typename StreamT, size_t MaxDLC>
+SerialCANBase::receive_status BasicSerialCAN<StreamT, MaxDLC>::unpackFrame_(
+    FrameT *incoming_frame) {
+    while (_rx_unpack_count > 0) {
+        const uint8_t *record = &_rx_window[_rx_unpack_pos];
+        size_t id_length = record[0] & PACKET_LONG_ID_FLAG ? 4 : 2;
+        size_t payload_length = payloadLength_(record[0] & ~PACKET_LONG_ID_FLAG);
+
+        _rx_unpack_pos += 3 + id_length + payload_length;
+        _rx_unpack_count--;
+
+        uint32_t arbitration_id = 0;
+        for (size_t i = 0; i < id_length; i++) {
+            arbitration_id |= static_cast<uint32_t>(record[i+3]) << (i * 8);
+        }
+
+        // Drop rejected frames without decoding them
+        if (_filter_bank.enabled() && !_filter_bank.accepts(arbitration_id)) {
+            _rejected_frames++;
+            continue;
+        }
+
+        // Timestamp is the packet base timestamp plus the record delta
+        incoming_frame->timestamp = record[1] | (static_cast<uint32_t>(record[2]) << 8);
+        for (int i = 0; i < 4; i++) {
+            incoming_frame->timestamp += static_cast<uint32_t>(_rx_window[i+2]) << (i * 8);
+        }
+        incoming_frame->arbitration_id = arbitration_id;
+        incoming_frame->dlc = payload_length;
+        incoming_frame->flags = record[0] & (FrameBase::fd_frame | FrameBase::bitrate_switch);
+        memcpy(incoming_frame->payload, &record[3 + id_length], payload_length);
+
+        return checkCRC_(incoming_frame);
+    }
+
+    return need_more_bytes;
+}
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_SERIALCANIMPL_HPP_
@@ -0,0 +1,452 @@
+/**********************************************************************************************
+ * SerialCAN, CAN communication over Serial bus - Version 1.0.0
+ * by Henrik Söderlund <henrik.a.soderlund@gmail.com>
+ *
+ * Copyright (c) 2023 Henrik Söderlund
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************************/
+
+#ifndef SERIALCAN_SRC_SIGNAL_HPP_
+#define SERIALCAN_SRC_SIGNAL_HPP_
+
+#include "Utils.hpp"
+#include "Frame.hpp"
+
+namespace serial_can {
+
+template<size_t Dlc, FrameBase::crc_settings UseCrc, typename... Signals>
+class MessageLayout;
+
+/**
+ * Common definitions of all signal types.
+ */
+class SignalBase {
+ public:
+    /**
+     * Byte order of a signal, as in DBC files.
+     */
+    enum byte_order {
+        little_endian,          /**< Intel (@1), the start bit is the least significant bit. */
+        big_endian              /**< Motorola (@0), the start bit is the most significant bit. */
+    };
+
+ protected:
+    /**
+     * Selects one of two types at compile time.
+     */
+    template<bool Condition, typename A, typename B>
+    struct Select_ { typedef A type; };
+
+    template<typename A, typename B>
+    struct Select_<false, A, B> { typedef B type; };
+
+    /**
+     * Smallest unsigned integer type with at least the given number of bits.
+     */
+    template<size_t Bits>
+    struct Unsigned_ {
+        typedef typename Select_<(Bits <= 8), uint8_t,
+            typename Select_<(Bits <= 16), uint16_t,
+            typename Select_<(Bits <= 32), uint32_t, uint64_t>::type>::type>::type type;
+    };
+
+    /**
+     * Smallest signed integer type with at least the given number of bits.
+     */
+    template<size_t Bits>
+    struct Signed_ {
+        typedef typename Select_<(Bits <= 8), int8_t,
+            typename Select_<(Bits <= 16), int16_t,
+            typename Select_<(Bits <= 32), int32_t, int64_t>::type>::type>::type type;
+    };
+
+    /**
+     * Byte mask with the bits from low to high set.
+     */
+    static constexpr uint8_t maskBits_(int low, int high) {
+        return static_cast<uint8_t>((0xFF << low) & (0xFF >> (7 - high)));
+    }
+};
+
+/**
+ * Signal of a CAN message, declared at compile time like a DBC signal. The bit position
+ * is resolved by the compiler into one shift and mask per payload byte, without loops.
+ *
+ * The physical value is raw * ScaleNum / ScaleDen + Offset. Signals with a scale of 1 have
+ * an integer physical value, other signals a float.
+ *
+ * @tparam StartBit The start bit as in DBC files, the least significant bit for
+ *                  little_endian and the most significant bit for big_endian signals.
+ * @tparam Length The length in bits, 1 to 64.
+ * @tparam Order The byte order.
+ * @tparam Signed Whether the raw value is two's complement.
+ * @tparam ScaleNum Numerator of the scale factor.
+ * @tparam ScaleDen Denominator of the scale factor.
+ * @tparam Offset Offset of the physical value.
+ */
+template<size_t StartBit, size_t Length, SignalBase::byte_order Order = SignalBase::little_endian,
+         bool Signed = false, int32_t ScaleNum = 1, int32_t ScaleDen = 1, int32_t Offset = 0>
+class Signal : public SignalBase {
+    static_assert(Length >= 1 && Length <= 64, "Signal length must be between 1 and 64 bits");
+    static_assert(StartBit < MAX_FD_DLC * 8, "Signal start bit is outside of the payload");
+    static_assert(ScaleNum != 0 && ScaleDen > 0, "Signal scale must be a non-zero fraction");
+
+    typedef typename Unsigned_<Length>::type Bits_;
+
+    /**
+     * Position of the least significant bit, counting the bits of each byte from the most
+     * significant one, so that big endian signals occupy consecutive positions.
+     */
+    static constexpr size_t lsb_position_ = (StartBit / 8) * 8 + 7 - StartBit % 8 + Length - 1;
+
+ public:
+    /**
+     * Type of the raw value.
+     */
+    typedef typename Select_<Signed, typename Signed_<Length>::type, Bits_>::type raw_type;
+
+    /**
+     * Type of the physical value.
+     */
+    typedef typename Select_<(ScaleNum == 1 && ScaleDen == 1),
+        typename Select_<(Offset == 0), raw_type, typename Signed_<Length + 1>::type>::type,
+        float>::type value_type;
+
+    /**
+     * Index of the first payload byte holding signal bits.
+     */
+    static constexpr size_t first_byte = StartBit / 8;
+
+    /**
+     * Index of the last payload byte holding signal bits.
+     */
+    static constexpr size_t last_byte = Order == little_endian ?
+        (StartBit + Length - 1) / 8 : lsb_position_ / 8;
+
+    /**
+     * Number of payload bytes needed to hold the signal.
+     */
+    static constexpr size_t byte_length = last_byte + 1;
+
+    /**
+     * Get the signal bits in a payload byte.
+     * @param byte The payload byte index.
+     * @return The mask of the signal bits, 0 if the byte holds none.
+     */
+    static constexpr uint8_t byteMask(size_t byte) {
+        return byte < first_byte || byte > last_byte ? 0 :
+            maskBits_(leftShift_(byte), highBit_(byte));
+    }
+
+    /**
+     * Writes a raw value into a payload, leaving the other bits unchanged.
+     * @param payload The payload, at least byte_length bytes.
+     * @param raw The raw value. Bits above the signal length are ignored.
+     */
+    static void pack(uint8_t *payload, raw_type raw) {
+        Bytes_<first_byte>::pack(payload, static_cast<Bits_>(raw));
+    }
+
+    /**
+     * Reads the raw value from a payload.
+     * @param payload The payload, at least byte_length bytes.
+     * @return The raw value, sign extended for signed signals.
+     */
+    static raw_type unpack(const uint8_t *payload) {
+        return signExtend_(Bytes_<first_byte>::unpack(payload));
+    }
+
+    /**
+     * Writes a physical value into a payload, leaving the other bits unchanged.
+     * @param payload The payload, at least byte_length bytes.
+     * @param value The physical value. Scaled values are rounded and limited to the range
+     *              of the signal.
+     */
+    static void encode(uint8_t *payload, value_type value) {
+        pack(payload, toRaw_(value));
+    }
+
+    /**
+     * Reads the physical value from a payload.
+     * @param payload The payload, at least byte_length bytes.
+     * @return The physical value.
+     */
+    static value_type decode(const uint8_t *payload) {
+        return toPhysical_(unpack(payload));
+    }
+
+    /**
+     * Writes a physical value into a frame.
+     * @param frame The frame, whose capacity is checked at compile time.
+     * @param value The physical value.
+     */
+    template<size_t Capacity>
+    static void set(BasicFrame<Capacity> *frame, value_type value) {
+        static_assert(byte_length <= Capacity, "Signal does not fit into the frame");
+        encode(frame->payload, value);
+    }
+
+    /**
+     * Reads the physical value from a frame.
+     * @param frame The frame, whose capacity is checked at compile time.
+     * @return The physical value.
+     */
+    template<size_t Capacity>
+    static value_type get(const BasicFrame<Capacity> &frame) {
+        static_assert(byte_length <= Capacity, "Signal does not fit into the frame");
+        return decode(frame.payload);
+    }
+
+ private:
+    template<size_t, FrameBase::crc_settings, typename...> friend class MessageLayout;
+
+    /**
+     * Signal bit number held by bit 0 of a payload byte, negative if the lowest signal bit
+     * is further up in the byte.
+     */
+    static constexpr int bitOffset_(size_t byte) {
+        return Order == little_endian ?
+            static_cast<int>(byte * 8) - static_cast<int>(StartBit) :
+            static_cast<int>((last_byte - byte) * 8) - static_cast<int>(7 - lsb_position_ % 8);
+    }
+
+    /**
+     * Shift from the signal bits down to a payload byte.
+     */
+    static constexpr int rightShift_(size_t byte) {
+        return bitOffset_(byte) > 0 ? bitOffset_(byte) : 0;
+    }
+
+    /**
+     * Shift from the signal bits up to a payload byte.
+     */
+    static constexpr int leftShift_(size_t byte) {
+        return bitOffset_(byte) < 0 ? -bitOffset_(byte) : 0;
+    }
+
+    /**
+     * Highest bit of a payload byte holding a signal bit.
+     */
+    static constexpr int highBit_(size_t byte) {
+        return static_cast<int>(Length) - 1 - bitOffset_(byte) > 7 ? 7 :
+            static_cast<int>(Length) - 1 - bitOffset_(byte);
+    }
+
+    /**
+     * Writes or merges the signal bits of each payload byte, unrolled by recursion.
+     * @tparam Byte The payload byte index.
+     */
+    template<size_t Byte, bool Done = (Byte > last_byte)>
+    struct Bytes_ {
+        static constexpr uint8_t mask = byteMask(Byte);
+
+        static void pack(uint8_t *payload, Bits_ bits) {
+            uint8_t value = static_cast<uint8_t>((bits >> rightShift_(Byte)) << leftShift_(Byte));
+            if (mask == 0xFF) {
+                payload[Byte] = value;
+            } else {
+                payload[Byte] = static_cast<uint8_t>((payload[Byte] & ~mask) | (value & mask));
+            }
+            Bytes_<Byte + 1>::pack(payload, bits);
+        }
+
+        static void merge(uint8_t *payload, Bits_ bits) {
+            uint8_t value = static_cast<uint8_t>((bits >> rightShift_(Byte)) << leftShift_(Byte));
+            payload[Byte] |= value & mask;
+            Bytes_<Byte + 1>::merge(payload, bits);
+        }
+
+        static Bits_ unpack(const uint8_t *payload) {
+            return static_cast<Bits_>(
+                (static_cast<Bits_>(payload[Byte] & mask) >> leftShift_(Byte)) <<
+                rightShift_(Byte)) | Bytes_<Byte + 1>::unpack(payload);
+        }
+    };
+
+    template<size_t Byte>
+    struct Bytes_<Byte, true> {
+        static void pack(uint8_t *, Bits_) {}
+        static void merge(uint8_t *, Bits_) {}
+        static Bits_ unpack(const uint8_t *) { return 0; }
+    };
+
+    /**
+     * ORs a raw value into a payload whose signal bits are zero.
+     */
+    static void merge_(uint8_t *payload, raw_type raw) {
+        Bytes_<first_byte>::merge(payload, static_cast<Bits_>(raw));
+    }
+
+    /**
+     * Sign extends the raw bits of signed signals.
+     */
+    static raw_type signExtend_(Bits_ bits) {
+        if (Signed && Length < sizeof(Bits_) * 8) {
+            const Bits_ sign = static_cast<Bits_>(Bits_(1) << ((Length - 1) % (sizeof(Bits_) * 8)));
+            bits = static_cast<Bits_>((bits ^ sign) - sign);
+        }
+        return static_cast<raw_type>(bits);
+    }
+
+    static constexpr Bits_ all_bits_ =
+        static_cast<Bits_>(static_cast<Bits_>(~Bits_(0)) >> (sizeof(Bits_) * 8 - Length));
+    static constexpr raw_type maximum_ = static_cast<raw_type>(Signed ? all_bits_ >> 1 : all_bits_);
+    static constexpr raw_type minimum_ =
+        static_cast<raw_type>(Signed ? -static_cast<raw_type>(maximum_) - 1 : 0);
+
+    // The float limits round up for wide signals, so they are only used for comparisons
+    static constexpr float minimum_raw_ = static_cast<float>(minimum_);
+    static constexpr float maximum_raw_ = static_cast<float>(maximum_);
+
+    /**
+     * Converts a raw value to the physical value.
+     */
+    static value_type toPhysical_(raw_type raw) {
+        return ScaleNum == 1 && ScaleDen == 1 ?
+            static_cast<value_type>(static_cast<value_type>(raw) + Offset) :
+            static_cast<value_type>(raw * (static_cast<float>(ScaleNum) / ScaleDen) + Offset);
+    }
+
+    /**
+     * Converts a physical value to the raw value.
+     */
+    static raw_type toRaw_(value_type value) {
+        if (ScaleNum == 1 && ScaleDen == 1) {
+            return static_cast<raw_type>(value - Offset);
+        }
+
+        float raw = (value - Offset) * (static_cast<float>(ScaleDen) / ScaleNum);
+        if (raw <= minimum_raw_) {
+            return minimum_;
+        } else if (raw >= maximum_raw_) {
+            return maximum_;
+        }
+        return static_cast<raw_type>(raw < 0 ? raw - 0.5f : raw + 0.5f);
+    }
+};
+
+/**
+ * Compile-time properties of a list of signals, used by MessageLayout.
+ */
+template<typename... Signals>
+struct SignalList {
+    static constexpr size_t byte_length = 0;    /**< Payload bytes needed by the signals. */
+    static constexpr bool disjoint = true;      /**< Whether no two signals share a bit. */
+
+    /**
+     * Checks whether a signal shares a bit with any signal of the list.
+     */
+    template<typename S>
+    static constexpr bool overlaps() { return false; }
+};
+
+template<typename First, typename... Rest>
+struct SignalList<First, Rest...> {
+    static constexpr size_t byte_length = First::byte_length > SignalList<Rest...>::byte_length ?
+        First::byte_length : SignalList<Rest...>::byte_length;
+    static constexpr bool disjoint = !SignalList<Rest...>::template overlaps<First>() &&
+        SignalList<Rest...>::disjoint;
+
+    template<typename S>
+    static constexpr bool overlaps() {
+        return overlapsFrom_<S>(S::first_byte) ||
+            SignalList<Rest...>::template overlaps<S>();
+    }
+
+ private:
+    template<typename S>
+    static constexpr bool overlapsFrom_(size_t byte) {
+        return byte <= S::last_byte &&
+            ((First::byteMask(byte) & S::byteMask(byte)) != 0 || overlapsFrom_<S>(byte + 1));
+    }
+};
+
+/**
+ * Layout of a CAN message, e.g. one message of a DBC file, with specialised encode() and
+ * decode() functions. The layout is checked at compile time: all signals must fit into the
+ * DLC, leaving the last 2 bytes for the counter and CRC if CRC is used, and no two signals
+ * may share a bit.
+ *
+ *     typedef Signal<0, 16, SignalBase::little_endian, false, 1, 4> EngineSpeed;
+ *     typedef Signal<16, 8, SignalBase::little_endian, false, 1, 1, -40> CoolantTemp;
+ *     typedef MessageLayout<8, FrameBase::crc8, EngineSpeed, CoolantTemp> EngineStatus;
+ *
+ *     EngineStatus::encode(&frame, 1500.25f, 90);
+ *
+ * @tparam Dlc The payload length of the message.
+ * @tparam UseCrc Whether the message is protected with CRC.
+ * @tparam Signals The signals of the message.
+ */
+template<size_t Dlc, FrameBase::crc_settings UseCrc, typename... Signals>
+class MessageLayout {
+ public:
+    /**
+     * Number of payload bytes available to signals.
+     */
+    static constexpr size_t data_length = UseCrc == FrameBase::crc8 ? Dlc - 2 : Dlc;
+
+    static_assert(Dlc <= MAX_FD_DLC, "Message DLC is larger than a CAN FD frame");
+    static_assert(UseCrc == FrameBase::no_crc || Dlc >= 2,
+        "Message DLC leaves no room for the counter and CRC bytes");
+    static_assert(SignalList<Signals...>::byte_length <= data_length,
+        "Signals do not fit into the DLC, minus 2 bytes for the counter and CRC if CRC is used");
+    static_assert(SignalList<Signals...>::disjoint, "Signals of a message must not overlap");
+
+    /**
+     * Sets the DLC, CRC setting and payload of a frame from the physical signal values.
+     * Payload bytes not covered by a signal are zero.
+     * @param frame The frame, whose capacity is checked at compile time.
+     * @param values The physical values, in the order of the signals.
+     */
+    template<size_t Capacity>
+    static void encode(BasicFrame<Capacity> *frame, typename Signals::value_type... values) {
+        static_assert(Dlc <= Capacity, "Message DLC is larger than the frame capacity");
+
+        frame->dlc = Dlc;
+        frame->use_crc = UseCrc;
+        memset(frame->payload, 0, data_length);
+        int expand[] = {0, (Signals::merge_(frame->payload, Signals::toRaw_(values)), 0)...};
+        static_cast<void>(expand);
+    }
+
+    /**
+     * Reads the physical signal values from a frame.
+     * @param frame The frame, whose capacity is checked at compile time.
+     * @param values Set to the physical values, in the order of the signals.
+     * @return True if the values were read, false if the frame is shorter than the DLC.
+     */
+    template<size_t Capacity>
+    static bool decode(const BasicFrame<Capacity> &frame,
+        typename Signals::value_type *... values) {
+        static_assert(Dlc <= Capacity, "Message DLC is larger than the frame capacity");
+
+        if (frame.dlc < Dlc) {
+            return false;
+        }
+        int expand[] = {0, (*values = Signals::decode(frame.payload), 0)...};
+        static_cast<void>(expand);
+        return true;
+    }
+};
+
+}  // namespace serial_can
+
+#endif  // SERIALCAN_SRC_SIGNAL_HPP_
@@ -27,9 +27,6 @@
 #ifndef SERIALCAN_SRC_UTILS_HPP_
 #define SERIALCAN_SRC_UTILS_HPP_
 
-#include "Arduino.h"
-#include "HardwareSerial.h"
-
 // The following code is made by Hideaki Tai, with some slight modifications
 // https://github.com/hideakitai/ArxTypeTraits
 //
@@ -58,6 +55,20 @@
     #define SERIALCAN_HAS_INCLUDE(x) __has_include(x)
 #endif
 
+// Arduino builds use the Arduino core. Any other build, e.g. Linux host tools and
+// benchmarks, uses the C library and the stand-ins at the end of this file.
+#if defined(ARDUINO) || SERIALCAN_HAS_INCLUDE("Arduino.h")
+    #define SERIALCAN_ARDUINO 1
+    #include "Arduino.h"
+    #include "HardwareSerial.h"
+#else
+    #define SERIALCAN_ARDUINO 0
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <string.h>
+    #include <time.h>
+#endif
+
 // Initializer_list *must* be defined in std, so take extra care to only
 // define it when <initializer_list> is really not available (e.g.
 // ArduinoSTL is C++98 but *does* define <initializer_list>) and not
@@ -124,4 +135,42 @@ end(initializer_list<_Ep> __il) noexcept {
 }  // namespace std
 #endif
 
+#if !SERIALCAN_ARDUINO
+/**
+ * Host stand-in for the Arduino micros() function.
+ * @return Microseconds since an arbitrary point, wrapping like on Arduino.
+ */
+inline uint32_t micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint32_t>(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+}
+
+/**
+ * Host stand-in for the Arduino millis() function.
+ * @return Milliseconds since an arbitrary point, wrapping like on Arduino.
+ */
+inline uint32_t millis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint32_t>(now.tv_sec * 1000ULL + now.tv_nsec / 1000000);
+}
+#endif
+
+// Flash storage is only distinct from RAM on some targets, elsewhere it is plain const data.
+#ifndef PROGMEM
+    #define PROGMEM
+#endif
+#ifndef pgm_read_byte
+    #define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+// Memory barrier for data shared between interrupt and main loop context.
+// A compiler barrier is sufficient on single core AVR, other targets get a full fence.
+#if defined(__AVR__)
+    #define SERIALCAN_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+    #define SERIALCAN_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
 #endif  // SERIALCAN_SRC_UTILS_HPP_
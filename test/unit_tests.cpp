@@ -33,9 +33,43 @@
 
 #include "Arduino.h"
 #include "SerialCAN.h"
+#include "PriorityTxQueue.hpp"
+#include "IsoTp.hpp"
+#include "SerialCANGateway.hpp"
+#include "Signal.hpp"
+#include "CyclicScheduler.hpp"
 
 using serial_can::SerialCAN;
+using serial_can::BasicSerialCAN;
 using serial_can::Frame; 
+using serial_can::FDFrame;
+using serial_can::IsPackable;
+using serial_can::MAX_FD_DLC;
+using serial_can::FrameRingBuffer;
+using serial_can::FramePool;
+using serial_can::FrameHandle;
+using serial_can::INVALID_FRAME_HANDLE;
+using serial_can::PriorityTxQueue;
+using serial_can::FilterBank;
+using serial_can::MaskFilter;
+using serial_can::StaticFrameDispatcher;
+using serial_can::IsoTpBase;
+using serial_can::CobsDecoder;
+using serial_can::SerialCANGateway;
+using serial_can::GatewayRoute;
+using serial_can::GatewayStatistics;
+using serial_can::Signal;
+using serial_can::SignalBase;
+using serial_can::SignalList;
+using serial_can::MessageLayout;
+using serial_can::FrameBase;
+using serial_can::CyclicScheduler;
+using serial_can::CyclicStatistics;
+using serial_can::SequenceTracker;
+using serial_can::StaticSequenceTracker;
+using serial_can::SequenceStatistics;
+using serial_can::LinkStatistics;
+using serial_can::IsoTpChannel;
 
 /**
  * Used for testing.
@@ -43,11 +77,14 @@ using serial_can::Frame;
 class DummySerial : public HardwareSerial {
  public:
     static const size_t buffer_size = 19;
+    static const size_t out_buffer_size = 64;
 
     size_t out_buffer_idx = 0;
-    uint8_t dummy_buffer[buffer_size] = {};
+    size_t write_calls = 0;
+    uint8_t dummy_buffer[out_buffer_size] = {};
 
     size_t in_buffer_idx = 0;
+    size_t in_buffer_end = buffer_size;
     uint8_t read_buffer[buffer_size] = {
       0xAA, 0x00, 0x00, 0x00, 0x01, 0x08, 0xFF, 0xFF, 0xFF, 0xFF,
       0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0xBB
@@ -60,7 +97,7 @@ class DummySerial : public HardwareSerial {
       static_cast<void>(a);
       static_cast<void>(b);
     };
-    int available(void) override { return in_buffer_idx < buffer_size; }
+    int available(void) override { return in_buffer_idx < in_buffer_end; }
     int peek(void) override { return 0; }
     int availableForWrite(void) { return 0; }
     void flush(void) override { return; }
@@ -72,10 +109,53 @@ class DummySerial : public HardwareSerial {
     }
     size_t write(uint8_t val) override {
       dummy_buffer[out_buffer_idx++] = val;
-      out_buffer_idx = out_buffer_idx >= buffer_size ? 0 : out_buffer_idx;
-      return 0;
+      out_buffer_idx = out_buffer_idx >= out_buffer_size ? 0 : out_buffer_idx;
+      write_calls++;
+      return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override {
+      for (size_t i = 0; i < size; i++) {
+        dummy_buffer[out_buffer_idx++] = buffer[i];
+        out_buffer_idx = out_buffer_idx >= out_buffer_size ? 0 : out_buffer_idx;
+      }
+      write_calls++;
+      return size;
+    }
+    void reset(void) { out_buffer_idx = 0; in_buffer_idx = 0; write_calls = 0; }
+};
+
+/**
+ * Plain stream without virtual calls, used for testing BasicSerialCAN.
+ */
+class LoopbackStream {
+ public:
+    static const size_t buffer_size = 128;
+
+    size_t write_idx = 0;
+    size_t read_idx = 0;
+    uint8_t buffer[buffer_size] = {};
+    int writable = buffer_size;
+
+    void begin(unsigned long baud) { static_cast<void>(baud); }
+    int available(void) { return write_idx - read_idx; }
+    int availableForWrite(void) { return writable; }
+    int read(void) {
+      if (!available()) {
+        return -1;
+      }
+      int val = buffer[read_idx++];
+      if (read_idx == write_idx) {
+        read_idx = write_idx = 0;
+      }
+      return val;
+    }
+    size_t write(uint8_t val) { return write(&val, 1); }
+    size_t write(const uint8_t *data, size_t size) {
+      size = size > buffer_size - write_idx ? buffer_size - write_idx : size;
+      memcpy(&buffer[write_idx], data, size);
+      write_idx += size;
+      return size;
     }
-    void reset(void) { out_buffer_idx = 0; in_buffer_idx = 0; }
 };
 
 unittest_setup()
@@ -119,6 +199,86 @@ unittest(test_frame_value)
   assertEqual(0xE2, example_frame.payload[3]);
 }
 
+unittest(test_frame_variadic_value)
+{
+  // An example CAN frame {arbitration_id, dlc, use_crc}
+  Frame example_frame{0xFF, 8, Frame::no_crc};
+  uint16_t speed;
+  uint8_t gear;
+  float ratio;
+
+  // Mixed types are packed one after the other in little-endian byte order
+  example_frame.encode<uint8_t>({0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+  example_frame.encode(static_cast<uint16_t>(0x1234), static_cast<uint8_t>(0x56), 1.5f);
+
+  assertEqual(0x34, example_frame.payload[0]);
+  assertEqual(0x12, example_frame.payload[1]);
+  assertEqual(0x56, example_frame.payload[2]);
+  assertEqual(0x00, example_frame.payload[3]);
+  assertEqual(0x00, example_frame.payload[4]);
+  assertEqual(0xC0, example_frame.payload[5]);
+  assertEqual(0x3F, example_frame.payload[6]);
+  assertEqual(0x00, example_frame.payload[7]);
+
+  assertTrue(example_frame.decode(speed, gear, ratio));
+  assertEqual(0x1234, speed);
+  assertEqual(0x56, gear);
+  assertEqual(1.5f, ratio);
+
+  // Frames shorter than the values are not decoded
+  example_frame.dlc = 6;
+  assertFalse(example_frame.decode(speed, gear, ratio));
+
+  // Char arrays are still encoded as strings
+  char text[] = "hi";
+  example_frame.encode(text);
+  assertEqual('h', example_frame.payload[0]);
+  assertEqual('i', example_frame.payload[1]);
+  assertEqual(0, example_frame.payload[2]);
+
+  // Values fill CAN FD payloads as well
+  FDFrame fd_frame{0x100, 16};
+  uint64_t first;
+  uint64_t second;
+  fd_frame.encode(static_cast<uint64_t>(1), static_cast<uint64_t>(0x0102030405060708));
+  assertEqual(0x08, fd_frame.payload[8]);
+  assertTrue(fd_frame.decode(first, second));
+  assertEqual(1, first);
+  assertEqual(0x0102030405060708, second);
+
+  // Only integer, floating point and enum values can be packed
+  bool packable_enum = IsPackable<FrameBase::crc_settings>::value;
+  bool packable_double = IsPackable<double>::value;
+  bool packable_pointer = IsPackable<uint8_t*>::value;
+  bool packable_frame = IsPackable<Frame>::value;
+  assertTrue(packable_enum);
+  assertTrue(packable_double);
+  assertFalse(packable_pointer);
+  assertFalse(packable_frame);
+}
+
+
+unittest(test_crc8_engines)
+{
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  uint8_t message[64];
+
+  // CRC-8 check value for polynomial 0x07
+  assertEqual(0xF4, serial_can::crc8Table(check, sizeof(check)));
+  assertEqual(0xF4, serial_can::crc8(check, sizeof(check)));
+
+  // All engines are bit identical for every message length
+  for (size_t i = 0; i < sizeof(message); i++) {
+    message[i] = static_cast<uint8_t>(i * 37 + 11);
+  }
+  for (size_t n = 0; n <= sizeof(message); n++) {
+    uint8_t expected = serial_can::crc8Table(message, n);
+    assertEqual(expected, serial_can::crc8Progmem(message, n));
+    assertEqual(expected, serial_can::crc8Nibble(message, n));
+    assertEqual(expected, serial_can::crc8Slice4(message, n));
+  }
+}
+
 
 unittest(test_serial_can_send)
 {
@@ -153,6 +313,41 @@ unittest(test_serial_can_send)
   assertEqual(0x00, dummySerial.dummy_buffer[14]);
   assertEqual(0x00, dummySerial.dummy_buffer[15]);
   assertEqual(0xBB, dummySerial.dummy_buffer[16]);
+  assertEqual(1, dummySerial.write_calls);
+}
+
+
+unittest(test_serial_can_send_batch)
+{
+  DummySerial dummySerial;
+
+  // Serial CAN communication
+  SerialCAN serialCAN{&dummySerial};
+  // Two example CAN frames {arbitration_id, dlc, use_crc}
+  Frame example_frames[2] = {{0x10, 2, Frame::no_crc}, {0x20, 1, Frame::no_crc}};
+
+  example_frames[0].encode<uint8_t>({0x01, 0x02});
+  example_frames[1].encode<uint8_t>({0x03});
+
+  // Dispatch both messages with a single write
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.sendBatch(example_frames, 2, 1);
+
+  assertEqual(1, dummySerial.write_calls);
+  assertEqual(25, dummySerial.out_buffer_idx);
+
+  assertEqual(0xAA, dummySerial.dummy_buffer[0]);
+  assertEqual(0x02, dummySerial.dummy_buffer[5]);
+  assertEqual(0x10, dummySerial.dummy_buffer[6]);
+  assertEqual(0x01, dummySerial.dummy_buffer[10]);
+  assertEqual(0x02, dummySerial.dummy_buffer[11]);
+  assertEqual(0xBB, dummySerial.dummy_buffer[12]);
+
+  assertEqual(0xAA, dummySerial.dummy_buffer[13]);
+  assertEqual(0x01, dummySerial.dummy_buffer[18]);
+  assertEqual(0x20, dummySerial.dummy_buffer[19]);
+  assertEqual(0x03, dummySerial.dummy_buffer[23]);
+  assertEqual(0xBB, dummySerial.dummy_buffer[24]);
 }
 
 
@@ -244,6 +439,1326 @@ unittest(test_serial_can_receive_with_crc)
   assertEqual(0x07, example_frame.counter);
 }
 
+unittest(test_serial_can_try_receive_partial)
+{
+  DummySerial dummySerial;
+
+  // Serial CAN communication
+  SerialCAN serialCAN{&dummySerial};
+  // An example CAN frame {arbitration_id, dlc, use_crc}
+  Frame example_frame{};
+
+  // Only the header has arrived
+  serialCAN.begin(460800);  // Does nothing here
+  dummySerial.in_buffer_end = 10;
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&example_frame));
+  assertEqual(SerialCAN::none, serialCAN.getFaultReason());
+
+  // Half of the payload has arrived
+  dummySerial.in_buffer_end = 14;
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&example_frame));
+
+  // The rest of the frame has arrived
+  dummySerial.in_buffer_end = DummySerial::buffer_size;
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&example_frame));
+
+  assertEqual(0xFFFFFFFF, example_frame.arbitration_id);
+  assertEqual(8, example_frame.dlc);
+  assertEqual(16777216, example_frame.timestamp);
+  assertEqual(0x01, example_frame.payload[0]);
+  assertEqual(0x08, example_frame.payload[7]);
+
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&example_frame));
+}
+
+unittest(test_serial_can_resync)
+{
+  DummySerial dummySerial;
+
+  // Serial CAN communication
+  SerialCAN serialCAN{&dummySerial};
+  // An example CAN frame {arbitration_id, dlc, use_crc}
+  Frame example_frame{};
+
+  // A stray start byte followed by a valid frame
+  const uint8_t stream_bytes[] = {
+    0xAA, 0x01, 0x02,
+    0xAA, 0x00, 0x00, 0x00, 0x00, 0x01, 0x10, 0x00, 0x00, 0x00, 0x55, 0xBB
+  };
+  memcpy(dummySerial.read_buffer, stream_bytes, sizeof(stream_bytes));
+  dummySerial.in_buffer_end = sizeof(stream_bytes);
+
+  serialCAN.begin(460800);  // Does nothing here
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&example_frame));
+  assertEqual(SerialCAN::missing_end_delimeter, serialCAN.getFaultReason());
+
+  // The frame that started inside the discarded window is recovered
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&example_frame));
+  assertEqual(0x10, example_frame.arbitration_id);
+  assertEqual(1, example_frame.dlc);
+  assertEqual(0x55, example_frame.payload[0]);
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&example_frame));
+
+  // A DLC that is too large is rejected early
+  dummySerial.reset();
+  dummySerial.read_buffer[5] = 0x09;
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&example_frame));
+  assertEqual(SerialCAN::invalid_dlc, serialCAN.getFaultReason());
+}
+
+unittest(test_crc_short_frame)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  Frame outgoing_frame{0x10, 1};
+  Frame incoming_frame{Frame::crc8};
+
+  serialCAN.begin(460800);  // Does nothing here
+
+  // A CRC protected frame needs room for the counter and CRC bytes
+  outgoing_frame.payload[0] = 0x55;
+  serialCAN.send(&outgoing_frame, 0);
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::invalid_dlc, serialCAN.getFaultReason());
+
+  outgoing_frame.dlc = 0;
+  serialCAN.send(&outgoing_frame, 0);
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::invalid_dlc, serialCAN.getFaultReason());
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&incoming_frame));
+}
+
+unittest(test_basic_serial_can_loopback)
+{
+  LoopbackStream loopback;
+
+  // Serial CAN communication over a plain stream type
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  Frame outgoing_frame{0x123, 6, Frame::crc8};
+  Frame incoming_frame{Frame::crc8};
+
+  outgoing_frame.encode("test");
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.send(&outgoing_frame, 42);
+  assertEqual(17, loopback.available());
+
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x123, incoming_frame.arbitration_id);
+  assertEqual(6, incoming_frame.dlc);
+  assertEqual(42, incoming_frame.timestamp);
+  assertEqual('t', incoming_frame.payload[0]);
+  assertEqual(0, incoming_frame.counter);
+  assertEqual(0x26, incoming_frame.crc);
+}
+
+unittest(test_can_fd_loopback)
+{
+  LoopbackStream loopback;
+
+  // CAN FD communication with payloads up to 64 bytes
+  BasicSerialCAN<LoopbackStream, MAX_FD_DLC> serialCAN{&loopback};
+  FDFrame outgoing_frame{0x123, 64, FDFrame::crc8, FDFrame::bitrate_switch};
+  FDFrame incoming_frame{FDFrame::crc8};
+
+  for (int i = 0; i < 62; i++) {
+    outgoing_frame.payload[i] = i;
+  }
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.send(&outgoing_frame, 42);
+  assertEqual(75, loopback.available());
+
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x123, incoming_frame.arbitration_id);
+  assertEqual(64, incoming_frame.dlc);
+  assertEqual(FDFrame::fd_frame | FDFrame::bitrate_switch, incoming_frame.flags);
+  assertEqual(61, incoming_frame.payload[61]);
+  assertEqual(0, incoming_frame.counter);
+
+  // Payload sizes without a DLC code are padded to the next valid size
+  FDFrame padded_frame{0x456, 10};
+  padded_frame.payload[9] = 0x99;
+  padded_frame.payload[10] = 0xFF;
+  incoming_frame.use_crc = FDFrame::no_crc;
+  serialCAN.send(&padded_frame, 43);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(12, incoming_frame.dlc);
+  assertEqual(FDFrame::fd_frame, incoming_frame.flags);
+  assertEqual(0x99, incoming_frame.payload[9]);
+  assertEqual(0, incoming_frame.payload[10]);
+
+  // Classic frames keep the classic format
+  FDFrame classic_frame{0x789, 2};
+  serialCAN.send(&classic_frame, 44);
+  assertEqual(13, loopback.available());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(2, incoming_frame.dlc);
+  assertEqual(0, incoming_frame.flags);
+
+  // A classic receiver rejects CAN FD payloads above 8 bytes
+  BasicSerialCAN<LoopbackStream> classicCAN{&loopback};
+  Frame classic_incoming_frame{};
+  serialCAN.send(&padded_frame, 45);
+  assertFalse(classicCAN.receive(&classic_incoming_frame, 100));
+  assertEqual(SerialCAN::invalid_dlc, classicCAN.getFaultReason());
+}
+
+unittest(test_filter_bank)
+{
+  FilterBank filter_bank;
+  const MaskFilter mask_filters[] = {{0x100, 0x700}};
+  const uint32_t exact_ids[] = {0x010, 0x020, 0x7FF};
+
+  assertTrue(filter_bank.accepts(0x123));
+
+  filter_bank.setMaskFilters(mask_filters, 1);
+  filter_bank.setExactIds(exact_ids, 3);
+  assertTrue(filter_bank.accepts(0x123));
+  assertTrue(filter_bank.accepts(0x1FF));
+  assertFalse(filter_bank.accepts(0x223));
+  assertTrue(filter_bank.accepts(0x010));
+  assertTrue(filter_bank.accepts(0x7FF));
+  assertFalse(filter_bank.accepts(0x011));
+
+  filter_bank.clear();
+  assertTrue(filter_bank.accepts(0x223));
+}
+
+unittest(test_serial_can_acceptance_filter)
+{
+  LoopbackStream loopback;
+
+  // Serial CAN communication over a plain stream type
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  const uint32_t exact_ids[] = {0x200};
+  Frame rejected_frame{0x100, 2};
+  Frame accepted_frame{0x200, 2};
+  Frame incoming_frame{};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.setExactIdFilter(exact_ids, 1);
+  serialCAN.send(&rejected_frame, 1);
+  serialCAN.send(&accepted_frame, 2);
+  serialCAN.send(&rejected_frame, 3);
+
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(0x200, incoming_frame.arbitration_id);
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(2, serialCAN.getRejectedFrameCount());
+}
+
+static uint32_t handled_exact_id = 0;
+static uint32_t handled_range_id = 0;
+
+static void onExactFrame(Frame *frame) { handled_exact_id = frame->arbitration_id; }
+static void onRangeFrame(Frame *frame) { handled_range_id = frame->arbitration_id; }
+
+unittest(test_serial_can_dispatch)
+{
+  LoopbackStream loopback;
+
+  // Serial CAN communication over a plain stream type
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  StaticFrameDispatcher<4, 1> dispatcher;
+  Frame exact_frame{0x123, 1};
+  Frame range_frame{0x456, 1};
+  Frame unhandled_frame{0x789, 1};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.setDispatcher(&dispatcher);
+  assertTrue(serialCAN.onFrame(0x200, onRangeFrame));
+  assertTrue(serialCAN.onFrame(0x123, onExactFrame));
+  assertTrue(serialCAN.onFrameRange(0x700, 0x400, onRangeFrame));
+  assertFalse(serialCAN.onFrameRange(0x700, 0x500, onRangeFrame));
+
+  serialCAN.send(&exact_frame, 1);
+  serialCAN.send(&range_frame, 2);
+  serialCAN.send(&unhandled_frame, 3);
+
+  assertEqual(2, serialCAN.dispatch());
+  assertEqual(0x123, handled_exact_id);
+  assertEqual(0x456, handled_range_id);
+  assertEqual(0, serialCAN.dispatch());
+}
+
+unittest(test_frame_ring_buffer)
+{
+  FrameRingBuffer<2> queue;
+  Frame example_frame{};
+
+  assertTrue(queue.empty());
+  assertEqual(2, queue.capacity());
+
+  assertTrue(queue.push(Frame{0x01, 1}));
+  assertTrue(queue.push(Frame{0x02, 2}));
+  assertTrue(queue.full());
+  assertFalse(queue.push(Frame{0x03, 3}));
+
+  assertTrue(queue.pop(&example_frame));
+  assertEqual(0x01, example_frame.arbitration_id);
+  assertTrue(queue.push(Frame{0x03, 3}));
+
+  assertTrue(queue.pop(&example_frame));
+  assertEqual(0x02, example_frame.arbitration_id);
+  assertTrue(queue.pop(&example_frame));
+  assertEqual(0x03, example_frame.arbitration_id);
+  assertFalse(queue.pop(&example_frame));
+  assertEqual(0, queue.size());
+}
+
+unittest(test_serial_can_receive_into)
+{
+  DummySerial dummySerial;
+
+  // Serial CAN communication
+  SerialCAN serialCAN{&dummySerial};
+  FrameRingBuffer<4> queue;
+  Frame example_frame{};
+
+  // Producer side parses the dummy frame into the ring buffer
+  serialCAN.begin(460800);  // Does nothing here
+  assertEqual(1, serialCAN.receiveInto(&queue));
+  assertEqual(0, serialCAN.receiveInto(&queue));
+
+  // Consumer side drains the ring buffer
+  assertTrue(queue.pop(&example_frame));
+  assertEqual(0xFFFFFFFF, example_frame.arbitration_id);
+  assertEqual(8, example_frame.dlc);
+  assertEqual(0x08, example_frame.payload[7]);
+  assertFalse(queue.pop(&example_frame));
+}
+
+unittest(test_frame_pool)
+{
+  FramePool<3> pool;
+  FrameHandle handles[3];
+
+  assertEqual(3, pool.capacity());
+  assertEqual(3, pool.available());
+
+  for (int i = 0; i < 3; i++) {
+    handles[i] = pool.acquire();
+    assertNotEqual(INVALID_FRAME_HANDLE, handles[i]);
+    pool[handles[i]]->arbitration_id = i;
+  }
+  assertEqual(0, pool.available());
+  assertEqual(INVALID_FRAME_HANDLE, pool.acquire());
+  assertNotEqual(handles[0], handles[1]);
+  assertNotEqual(handles[1], handles[2]);
+
+  // The most recently released frame is acquired first, with its E2E counter intact
+  pool[handles[1]]->counter = 7;
+  pool.release(handles[1]);
+  assertEqual(1, pool.available());
+  assertEqual(handles[1], pool.acquire());
+  assertEqual(1, pool.get(handles[1])->arbitration_id);
+  assertEqual(7, pool.get(handles[1])->counter);
+}
+
+unittest(test_frame_pool_serial_can)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  FramePool<2> pool;
+  FrameRingBuffer<4, FrameHandle> rx_queue;
+  Frame outgoing_frame{0x100, 8, Frame::crc8};
+  FrameHandle handle;
+
+  serialCAN.begin(460800);  // Does nothing here
+
+  // Frames are received into the pool until it runs out
+  for (int i = 0; i < 3; i++) {
+    outgoing_frame.payload[0] = i;
+    serialCAN.send(&outgoing_frame, i);
+  }
+  assertEqual(2, serialCAN.receiveInto(&pool, &rx_queue, Frame::crc8));
+  assertEqual(0, pool.available());
+  assertEqual(2, rx_queue.size());
+  assertTrue(loopback.available() > 0);
+
+  // Handles move from the receive queue to send(), which returns the frames to the pool
+  assertTrue(rx_queue.pop(&handle));
+  assertEqual(0, pool[handle]->payload[0]);
+  assertEqual(Frame::crc8, pool[handle]->use_crc);
+  pool[handle]->arbitration_id = 0x200;
+  serialCAN.send(&pool, handle, 10);
+  assertEqual(1, pool.available());
+
+  // The third frame is read now that a frame is free
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&pool, &handle, Frame::crc8));
+  assertEqual(2, pool[handle]->payload[0]);
+  assertEqual(2, pool[handle]->timestamp);
+  pool.release(handle);
+
+  // The frame sent from the pool is received with its new ID
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&pool, &handle, Frame::crc8));
+  assertEqual(0x200, pool[handle]->arbitration_id);
+  assertEqual(10, pool[handle]->timestamp);
+  pool.release(handle);
+
+  // Incomplete frames do not hold on to a pooled frame
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&pool, &handle, Frame::crc8));
+  assertEqual(1, pool.available());
+  assertTrue(rx_queue.pop(&handle));
+  pool.release(handle);
+  assertEqual(2, pool.available());
+
+  // Pooled frames keep advancing their counter, so they pass sequence tracking
+  StaticSequenceTracker<1> tracker;
+  Frame incoming_frame{Frame::crc8};
+  serialCAN.setSequenceTracker(&tracker);
+  handle = pool.acquire();
+  *pool[handle] = Frame{0x300, 4, Frame::crc8};
+  for (int i = 0; i < 3; i++) {
+    serialCAN.send(&pool, handle, 20);
+    assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+    assertEqual(i, incoming_frame.counter);
+    assertEqual(SerialCAN::none, serialCAN.getFaultReason());
+
+    // The most recently released frame is acquired again
+    handle = pool.acquire();
+  }
+  pool.release(handle);
+}
+
+unittest(test_priority_tx_queue)
+{
+  DummySerial dummySerial;
+
+  // Serial CAN communication
+  SerialCAN serialCAN{&dummySerial};
+  PriorityTxQueue<4> tx_queue{&serialCAN};
+  Frame low_priority{0x300, 0};
+  Frame high_priority{0x100, 0};
+  Frame mid_priority{0x200, 0};
+
+  serialCAN.begin(460800);  // Does nothing here
+  assertTrue(tx_queue.enqueue(&low_priority));
+  assertTrue(tx_queue.enqueue(&high_priority));
+  assertTrue(tx_queue.enqueue(&mid_priority));
+  assertTrue(tx_queue.enqueue(&high_priority));
+  assertFalse(tx_queue.enqueue(&mid_priority));
+  assertEqual(2, high_priority.counter);
+
+  // Lowest arbitration ID wins, equal IDs keep their order
+  assertEqual(1, tx_queue.poll(1));
+  assertEqual(0x00, dummySerial.dummy_buffer[6]);
+  assertEqual(0x01, dummySerial.dummy_buffer[7]);
+  assertEqual(3, tx_queue.poll(1, 8));
+  assertEqual(0x01, dummySerial.dummy_buffer[11 + 7]);
+  assertEqual(0x02, dummySerial.dummy_buffer[22 + 7]);
+  assertEqual(0x03, dummySerial.dummy_buffer[33 + 7]);
+  assertTrue(tx_queue.empty());
+}
+
+unittest(test_priority_tx_queue_replace_same_id)
+{
+  DummySerial dummySerial;
+
+  // Serial CAN communication
+  SerialCAN serialCAN{&dummySerial};
+  PriorityTxQueue<4> tx_queue{&serialCAN, true};
+  Frame example_frame{0x100, 1};
+
+  serialCAN.begin(460800);  // Does nothing here
+  example_frame.encode<uint8_t>({0x01});
+  assertTrue(tx_queue.enqueue(&example_frame));
+  example_frame.encode<uint8_t>({0x02});
+  assertTrue(tx_queue.enqueue(&example_frame));
+  assertEqual(1, tx_queue.size());
+
+  // Only the latest frame is sent
+  assertEqual(1, tx_queue.poll(1, 8));
+  assertEqual(0x02, dummySerial.dummy_buffer[10]);
+  assertEqual(12, dummySerial.out_buffer_idx);
+  assertEqual(1, example_frame.counter);
+}
+
+unittest(test_priority_tx_queue_replace_counter)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  PriorityTxQueue<4, BasicSerialCAN<LoopbackStream> > tx_queue{&serialCAN, true};
+  StaticSequenceTracker<1> tracker;
+  Frame outgoing_frame{0x100, 4, Frame::crc8};
+  Frame incoming_frame{Frame::crc8};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.setSequenceTracker(&tracker);
+
+  // Replaced frames are never sent, so they do not use up a counter value
+  for (int i = 0; i < 3; i++) {
+    assertTrue(tx_queue.enqueue(&outgoing_frame));
+    assertTrue(tx_queue.enqueue(&outgoing_frame));
+    assertEqual(1, tx_queue.poll(i));
+    assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+    assertEqual(i, incoming_frame.counter);
+    assertEqual(SerialCAN::none, serialCAN.getFaultReason());
+  }
+  assertEqual(0, tracker.getLostFrames(0x100));
+}
+
+unittest(test_send_packet)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  uint8_t packet_buffer[96];
+  Frame outgoing_frames[8];
+  Frame incoming_frame{};
+
+  for (int i = 0; i < 8; i++) {
+    outgoing_frames[i] = Frame{0x100u + i, 2};
+    outgoing_frames[i].timestamp = 1000 + i;
+    outgoing_frames[i].payload[0] = i;
+  }
+  outgoing_frames[7].arbitration_id = 0x18FF0001;
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.enablePackets(packet_buffer, sizeof(packet_buffer));
+
+  // 8 frames share one header, 7 records with 2-byte IDs and one with a 4-byte ID
+  serialCAN.sendPacket(outgoing_frames, 8);
+  assertEqual(66, loopback.available());
+
+  for (int i = 0; i < 8; i++) {
+    assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+    assertEqual(outgoing_frames[i].arbitration_id, incoming_frame.arbitration_id);
+    assertEqual(1000 + i, incoming_frame.timestamp);
+    assertEqual(2, incoming_frame.dlc);
+    assertEqual(i, incoming_frame.payload[0]);
+  }
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&incoming_frame));
+
+  // Plain frames are still received while packets are enabled
+  serialCAN.send(&outgoing_frames[0], 5);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x100, incoming_frame.arbitration_id);
+
+  // A timestamp delta that does not fit in 16 bits starts a new packet
+  Frame crc_frames[2] = {{0x10, 4, Frame::crc8}, {0x20, 4, Frame::crc8}};
+  Frame crc_incoming_frame{Frame::crc8};
+  crc_frames[1].timestamp = 0x10000;
+  serialCAN.sendPacket(crc_frames, 2);
+  assertEqual(2 * (6 + 9 + 2), loopback.available());
+  assertTrue(serialCAN.receive(&crc_incoming_frame, 100));
+  assertEqual(0x10, crc_incoming_frame.arbitration_id);
+  assertTrue(serialCAN.receive(&crc_incoming_frame, 100));
+  assertEqual(0x20, crc_incoming_frame.arbitration_id);
+  assertEqual(0x10000, crc_incoming_frame.timestamp);
+
+  // A corrupt packet is discarded as a whole
+  serialCAN.sendPacket(outgoing_frames, 2);
+  loopback.buffer[10] ^= 0x01;
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::crc_mismatch, serialCAN.getFaultReason());
+  while (serialCAN.tryReceive(&incoming_frame) != SerialCAN::need_more_bytes) {
+    assertNotEqual(0x100, incoming_frame.arbitration_id);
+  }
+
+  // Records are filtered like frames
+  const uint32_t exact_ids[] = {0x103};
+  serialCAN.setExactIdFilter(exact_ids, 1);
+  serialCAN.sendPacket(outgoing_frames, 8);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(0x103, incoming_frame.arbitration_id);
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(7, serialCAN.getRejectedFrameCount());
+}
+
+unittest(test_compact_header)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  Frame outgoing_frame{0x123, 2};
+  Frame extended_frame{0x18FF0001, 8};
+  Frame incoming_frame{};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.setHeaderFormat(SerialCAN::compact_header);
+
+  // Compact header frames are only received once enabled
+  serialCAN.send(&outgoing_frame, 50000);
+  assertFalse(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(SerialCAN::no_incoming_data, serialCAN.getFaultReason());
+  assertEqual(0, loopback.available());
+  serialCAN.enableCompactHeaders();
+  serialCAN.setHeaderFormat(SerialCAN::compact_header);
+
+  // The first frame after selecting the format carries an absolute timestamp
+  serialCAN.send(&outgoing_frame, 100000);
+  assertEqual(11, loopback.available());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x123, incoming_frame.arbitration_id);
+  assertEqual(100000, incoming_frame.timestamp);
+
+  // Then 1 and 2 byte deltas
+  serialCAN.send(&outgoing_frame, 100003);
+  assertEqual(8, loopback.available());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(100003, incoming_frame.timestamp);
+
+  serialCAN.send(&extended_frame, 100503);
+  assertEqual(2 + 2 + 4 + 8 + 1, loopback.available());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x18FF0001, incoming_frame.arbitration_id);
+  assertEqual(8, incoming_frame.dlc);
+  assertEqual(100503, incoming_frame.timestamp);
+
+  // Rejected frames still advance the delta timestamps
+  const uint32_t exact_ids[] = {0x18FF0001};
+  serialCAN.setExactIdFilter(exact_ids, 1);
+  serialCAN.send(&outgoing_frame, 100510);
+  serialCAN.send(&extended_frame, 100520);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(100520, incoming_frame.timestamp);
+  assertEqual(1, serialCAN.getRejectedFrameCount());
+  serialCAN.clearFilters();
+
+  // An absolute timestamp is sent every sync interval
+  for (int i = 0; i < SERIALCAN_COMPACT_SYNC_INTERVAL - 4; i++) {
+    serialCAN.send(&outgoing_frame, 100521 + i);
+    assertTrue(serialCAN.receive(&incoming_frame, 100));
+  }
+  serialCAN.send(&outgoing_frame, 200000);
+  assertEqual(11, loopback.available());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(200000, incoming_frame.timestamp);
+
+  // Standard headers are still received
+  serialCAN.setHeaderFormat(SerialCAN::standard_header);
+  serialCAN.send(&outgoing_frame, 7);
+  assertEqual(13, loopback.available());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(7, incoming_frame.timestamp);
+}
+
+unittest(test_cobs)
+{
+  uint8_t data[300];
+  uint8_t encoded[300 + 3];
+  uint8_t decoded[300];
+  CobsDecoder decoder;
+
+  for (int i = 0; i < 300; i++) {
+    data[i] = i % 7 == 0 && i < 100 ? 0 : i;
+  }
+  data[299] = 0;
+
+  // Groups of 254 non-zero bytes, zeros and a trailing zero
+  size_t length = serial_can::cobsEncode(data, 300, encoded);
+  assertTrue(length <= 300 + serial_can::cobsMaxOverhead(300));
+  assertEqual(0, memchr(encoded, 0, length));
+
+  size_t n_decoded = 0;
+  for (size_t i = 0; i < length; i++) {
+    assertNotEqual(CobsDecoder::end_of_block, decoder.decode(encoded[i], &decoded[n_decoded]));
+    n_decoded = decoder.decoded();
+  }
+  assertEqual(300, n_decoded);
+  assertEqual(0, memcmp(data, decoded, 300));
+  assertEqual(CobsDecoder::end_of_block, decoder.decode(0x00, &decoded[0]));
+  assertEqual(0, decoder.decoded());
+
+  // Encoding in place
+  memcpy(&encoded[2], data, 300);
+  assertEqual(length, serial_can::cobsEncode(&encoded[2], 300, encoded));
+}
+
+unittest(test_cobs_framing)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  Frame outgoing_frame{0x1AA, 4};
+  Frame incoming_frame{};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.setFraming(SerialCAN::cobs_framing);
+
+  // Markers and zeros inside the frame are stuffed
+  outgoing_frame.encode<uint8_t>({0xAA, 0x00, 0xBB, 0x00});
+  serialCAN.send(&outgoing_frame, 0);
+  assertEqual(15 + 2, loopback.available());
+  assertEqual(0, memchr(loopback.buffer, 0, 16));
+  assertEqual(0, loopback.buffer[16]);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x1AA, incoming_frame.arbitration_id);
+  assertEqual(0xAA, incoming_frame.payload[0]);
+  assertEqual(0xBB, incoming_frame.payload[2]);
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&incoming_frame));
+
+  // A corrupt frame costs exactly that frame
+  Frame outgoing_frames[3] = {{0x10, 2}, {0x20, 2}, {0x30, 2}};
+  serialCAN.sendBatch(outgoing_frames, 3, 0);
+  assertEqual(3 * (13 + 2), loopback.available());
+  loopback.buffer[6] = 0xAA;
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::invalid_dlc, serialCAN.getFaultReason());
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(0x20, incoming_frame.arbitration_id);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(0x30, incoming_frame.arbitration_id);
+  assertEqual(SerialCAN::need_more_bytes, serialCAN.tryReceive(&incoming_frame));
+
+  // A block that ends inside a frame is reported
+  serialCAN.send(&outgoing_frame, 0);
+  loopback.buffer[8] = 0x00;
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::framing_error, serialCAN.getFaultReason());
+  while (serialCAN.tryReceive(&incoming_frame) != SerialCAN::need_more_bytes) {}
+
+  // Super-packets are framed as one block
+  uint8_t packet_buffer[64];
+  serialCAN.enablePackets(packet_buffer, sizeof(packet_buffer));
+  serialCAN.sendPacket(outgoing_frames, 3);
+  assertEqual(6 + 3 * 7 + 2 + 2, loopback.available());
+  for (int i = 0; i < 3; i++) {
+    assertTrue(serialCAN.receive(&incoming_frame, 100));
+    assertEqual(outgoing_frames[i].arbitration_id, incoming_frame.arbitration_id);
+  }
+}
+
+unittest(test_try_send)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  uint8_t tx_queue[32];
+  Frame outgoing_frame{0x123, 6, Frame::crc8};
+  Frame incoming_frame{Frame::crc8};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.enableTxQueue(tx_queue, sizeof(tx_queue));
+
+  // Only as many bytes as the stream accepts are written
+  loopback.writable = 5;
+  assertTrue(serialCAN.trySend(&outgoing_frame, 1));
+  assertEqual(5, loopback.available());
+  assertEqual(12, serialCAN.getTxQueueLength());
+
+  // A frame that does not fit is rejected untouched, without advancing its counter
+  assertTrue(serialCAN.trySend(&outgoing_frame, 2));
+  assertEqual(2, outgoing_frame.counter);
+  outgoing_frame.payload[4] = 0xEE;
+  outgoing_frame.payload[5] = 0xEE;
+  assertFalse(serialCAN.trySend(&outgoing_frame, 3));
+  assertEqual(2, outgoing_frame.counter);
+  assertEqual(0xEE, outgoing_frame.payload[4]);
+  assertEqual(0xEE, outgoing_frame.payload[5]);
+  assertEqual(10, loopback.available());
+
+  // The queue wraps around
+  assertEqual(5, serialCAN.flushSome());
+  assertEqual(5, serialCAN.flushSome());
+  assertTrue(serialCAN.trySend(&outgoing_frame, 3));
+  loopback.writable = 0;
+  assertEqual(0, serialCAN.flushSome());
+  loopback.writable = 64;
+  assertEqual(26, serialCAN.flushSome());
+  assertEqual(0, serialCAN.getTxQueueLength());
+
+  for (int i = 0; i < 3; i++) {
+    assertTrue(serialCAN.receive(&incoming_frame, 100));
+    assertEqual(i + 1, incoming_frame.timestamp);
+    assertEqual(i, incoming_frame.counter);
+  }
+
+  // send() writes the queued frames first
+  loopback.writable = 0;
+  assertTrue(serialCAN.trySend(&outgoing_frame, 4));
+  serialCAN.send(&outgoing_frame, 5);
+  assertEqual(0, serialCAN.getTxQueueLength());
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(4, incoming_frame.timestamp);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(5, incoming_frame.timestamp);
+}
+
+unittest(test_serial_can_gateway)
+{
+  LoopbackStream streams[3];
+  BasicSerialCAN<LoopbackStream> port0{&streams[0]};
+  BasicSerialCAN<LoopbackStream> port1{&streams[1]};
+  BasicSerialCAN<LoopbackStream> port2{&streams[2]};
+  BasicSerialCAN<LoopbackStream> *ports[3] = {&port0, &port1, &port2};
+
+  // 0x100-0x1FF from port 2 goes to ports 0 and 1, 0x200-0x2FF from anywhere goes to
+  // port 0 and is moved to 0x300-0x3FF
+  const GatewayRoute routes[] = {
+    {0x100, 0x700, 0x04, 0x03, 0, 0},
+    {0x200, 0x700, 0x07, 0x01, 0x700, 0x300},
+  };
+  SerialCANGateway<3, BasicSerialCAN<LoopbackStream> > gateway{ports, routes, 2};
+  Frame outgoing_frame{0x123, 6, Frame::crc8};
+  Frame incoming_frame{Frame::crc8};
+
+  outgoing_frame.encode("test");
+  for (int i = 0; i < 3; i++) {
+    ports[i]->begin(460800);  // Does nothing here
+  }
+
+  // Each port writes to the same loopback stream it reads from, so frames are only
+  // forwarded to ports that have already been polled and read back afterwards
+  port2.send(&outgoing_frame, 42);
+  assertEqual(1, gateway.poll());
+  assertEqual(0, streams[2].available());
+  assertTrue(port0.receive(&incoming_frame, 100));
+  assertEqual(0x123, incoming_frame.arbitration_id);
+  assertEqual(42, incoming_frame.timestamp);
+  assertEqual('t', incoming_frame.payload[0]);
+  assertEqual(0, incoming_frame.counter);
+  assertTrue(port1.receive(&incoming_frame, 100));
+  assertEqual(0x123, incoming_frame.arbitration_id);
+
+  // ID translation, with the destination using the compact header
+  outgoing_frame.arbitration_id = 0x234;
+  port0.enableCompactHeaders();
+  port0.setHeaderFormat(SerialCAN::compact_header);
+  port1.send(&outgoing_frame, 43);
+  assertEqual(1, gateway.poll());
+  assertTrue(port0.receive(&incoming_frame, 100));
+  assertEqual(0x334, incoming_frame.arbitration_id);
+  assertEqual(43, incoming_frame.timestamp);
+  assertEqual(1, incoming_frame.counter);
+
+  // Compact header frames are decoded and forwarded too
+  outgoing_frame.arbitration_id = 0x1FF;
+  port2.enableCompactHeaders();
+  port2.setHeaderFormat(SerialCAN::compact_header);
+  port2.send(&outgoing_frame, 44);
+  assertEqual(1, gateway.poll());
+  assertTrue(port1.receive(&incoming_frame, 100));
+  assertEqual(0x1FF, incoming_frame.arbitration_id);
+  assertEqual(44, incoming_frame.timestamp);
+  assertEqual(2, incoming_frame.counter);
+  assertTrue(port0.receive(&incoming_frame, 100));
+  assertEqual(0x1FF, incoming_frame.arbitration_id);
+
+  // Frames without a route are dropped
+  outgoing_frame.arbitration_id = 0x123;
+  port1.send(&outgoing_frame, 45);
+  assertEqual(0, gateway.poll());
+  assertEqual(0, streams[0].available());
+
+  const GatewayStatistics &statistics = gateway.getStatistics();
+  assertEqual(3, statistics.forwarded_frames);
+  assertEqual(5, statistics.sent_frames);
+  assertEqual(1, statistics.unrouted_frames);
+  assertTrue(statistics.max_forward_us >= statistics.last_forward_us);
+  gateway.resetStatistics();
+  assertEqual(0, gateway.getStatistics().forwarded_frames);
+}
+
+unittest(test_signal)
+{
+  uint8_t payload[8] = {};
+
+  // Intel signals start at their least significant bit
+  Signal<4, 12>::pack(payload, 0xABC);
+  assertEqual(0xC0, payload[0]);
+  assertEqual(0xAB, payload[1]);
+  assertEqual(0xABC, (Signal<4, 12>::unpack(payload)));
+
+  // Motorola signals start at their most significant bit
+  memset(payload, 0, sizeof(payload));
+  Signal<3, 12, SignalBase::big_endian>::pack(payload, 0xABC);
+  assertEqual(0x0A, payload[0]);
+  assertEqual(0xBC, payload[1]);
+  assertEqual(0xABC, (Signal<3, 12, SignalBase::big_endian>::unpack(payload)));
+
+  // Bits of other signals are kept, signed values are sign extended
+  memset(payload, 0xFF, sizeof(payload));
+  Signal<5, 20, SignalBase::big_endian, true>::pack(payload, -123456);
+  assertEqual(0xF8, payload[0]);
+  assertEqual(0x77, payload[1]);
+  assertEqual(0x03, payload[2]);
+  assertEqual(-123456, (Signal<5, 20, SignalBase::big_endian, true>::unpack(payload)));
+
+  // 64 bit signals, unaligned
+  uint8_t wide_payload[9] = {};
+  Signal<3, 64, SignalBase::little_endian, true>::pack(wide_payload, -5);
+  assertEqual(0xD8, wide_payload[0]);
+  assertEqual(0x07, wide_payload[8]);
+  assertEqual(-5, (Signal<3, 64, SignalBase::little_endian, true>::unpack(wide_payload)));
+
+  // Scaled values are rounded and limited to the signal range
+  typedef Signal<0, 8, SignalBase::little_endian, false, 1, 2> HalfSteps;
+  HalfSteps::encode(payload, 10.3f);
+  assertEqual(21, payload[0]);
+  assertEqual(10.5f, HalfSteps::decode(payload));
+  HalfSteps::encode(payload, 300.0f);
+  assertEqual(255, payload[0]);
+  HalfSteps::encode(payload, -3.0f);
+  assertEqual(0, payload[0]);
+
+  // Wide scaled signals are limited to their integer range
+  typedef Signal<0, 32, SignalBase::little_endian, true, 1, 10> Wide;
+  typedef Signal<0, 32, SignalBase::little_endian, false, 1, 10> WideUnsigned;
+  typedef Signal<0, 64, SignalBase::little_endian, true, 1, 10> Widest;
+  typedef Signal<0, 64, SignalBase::little_endian, false, 1, 10> WidestUnsigned;
+  Wide::encode(wide_payload, 1e12f);
+  assertEqual(2147483647, Wide::unpack(wide_payload));
+  Wide::encode(wide_payload, -1e12f);
+  assertEqual(-2147483647 - 1, Wide::unpack(wide_payload));
+  WideUnsigned::encode(wide_payload, 1e12f);
+  assertEqual(0xFFFFFFFF, WideUnsigned::unpack(wide_payload));
+  Widest::encode(wide_payload, 1e30f);
+  assertEqual(0x7FFFFFFFFFFFFFFFLL, Widest::unpack(wide_payload));
+  Widest::encode(wide_payload, -1e30f);
+  assertEqual(-0x7FFFFFFFFFFFFFFFLL - 1, Widest::unpack(wide_payload));
+  WidestUnsigned::encode(wide_payload, 1e30f);
+  assertEqual(0xFFFFFFFFFFFFFFFFULL, WidestUnsigned::unpack(wide_payload));
+  WidestUnsigned::encode(wide_payload, -1.0f);
+  assertEqual(0, WidestUnsigned::unpack(wide_payload));
+}
+
+unittest(test_message_layout)
+{
+  typedef Signal<0, 16, SignalBase::little_endian, false, 1, 4> EngineSpeed;
+  typedef Signal<16, 8, SignalBase::little_endian, false, 1, 1, -40> CoolantTemp;
+  typedef Signal<24, 5, SignalBase::little_endian, true> Gear;
+  typedef Signal<39, 8, SignalBase::big_endian> Status;
+  typedef MessageLayout<8, FrameBase::crc8, EngineSpeed, CoolantTemp, Gear, Status> Message;
+
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  Frame outgoing_frame{0x100, 2};
+  Frame incoming_frame{Frame::crc8};
+  float engine_speed;
+  int16_t coolant_temp;
+  int8_t gear;
+  uint8_t status;
+
+  // Copied, as the assertions take their arguments by reference
+  size_t data_length = Message::data_length;
+  size_t byte_length = SignalList<EngineSpeed, CoolantTemp, Gear, Status>::byte_length;
+  assertEqual(6, data_length);
+  assertEqual(5, byte_length);
+
+  // Encoding sets the DLC and CRC setting, and clears bytes not covered by a signal
+  outgoing_frame.encode<uint8_t>({0xFF, 0xFF});
+  Message::encode(&outgoing_frame, 1500.25f, -10, -3, 0x5A);
+  assertEqual(8, outgoing_frame.dlc);
+  assertEqual(Frame::crc8, outgoing_frame.use_crc);
+  assertEqual(0x71, outgoing_frame.payload[0]);
+  assertEqual(0x17, outgoing_frame.payload[1]);
+  assertEqual(0x1E, outgoing_frame.payload[2]);
+  assertEqual(0x1D, outgoing_frame.payload[3]);
+  assertEqual(0x5A, outgoing_frame.payload[4]);
+  assertEqual(0x00, outgoing_frame.payload[5]);
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.send(&outgoing_frame, 0);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertTrue(Message::decode(incoming_frame, &engine_speed, &coolant_temp, &gear, &status));
+  assertEqual(1500.25f, engine_speed);
+  assertEqual(-10, coolant_temp);
+  assertEqual(-3, gear);
+  assertEqual(0x5A, status);
+  assertEqual(-10, CoolantTemp::get(incoming_frame));
+
+  // Frames shorter than the layout are not decoded
+  incoming_frame.dlc = 4;
+  assertFalse(Message::decode(incoming_frame, &engine_speed, &coolant_temp, &gear, &status));
+}
+
+unittest(test_cyclic_scheduler)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  CyclicScheduler<3, BasicSerialCAN<LoopbackStream> > scheduler{&serialCAN, 1000};
+  Frame frame_10ms{0x10, 1};
+  Frame frame_20ms{0x20, 1};
+  Frame frame_100ms{0x100, 1};
+  Frame incoming_frame{};
+  Frame extra_frame{0x200, 1};
+
+  serialCAN.begin(460800);  // Does nothing here
+
+  // Phases are spread so that releases do not coincide
+  assertTrue(scheduler.add(&frame_10ms, 10000, [](Frame *frame) { frame->payload[0]++; }));
+  assertTrue(scheduler.add(&frame_20ms, 20000));
+  assertTrue(scheduler.add(&frame_100ms, 100000));
+  assertFalse(scheduler.add(&extra_frame, 50000));
+  assertEqual(0, scheduler.getPhase(0));
+  assertEqual(5000, scheduler.getPhase(1));
+  assertEqual(15000, scheduler.getPhase(2));
+
+  // The first tick starts the schedule
+  assertEqual(1, scheduler.tick(1000000));
+  assertEqual(0, scheduler.tick(1004000));
+  assertEqual(1, scheduler.tick(1005000));
+  assertEqual(1, scheduler.tick(1010000));
+  assertEqual(1, scheduler.tick(1015000));
+  assertEqual(5000, scheduler.timeUntilNext(1015000));
+
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x10, incoming_frame.arbitration_id);
+  assertEqual(1, incoming_frame.payload[0]);
+  assertEqual(1000, incoming_frame.timestamp);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x20, incoming_frame.arbitration_id);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x10, incoming_frame.arbitration_id);
+  assertEqual(2, incoming_frame.payload[0]);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x100, incoming_frame.arbitration_id);
+
+  // A late tick sends the most overdue frame first and counts the missed release
+  assertEqual(1, scheduler.tick(1031000, 1));
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x10, incoming_frame.arbitration_id);
+  assertEqual(1, scheduler.tick(1031000));
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x20, incoming_frame.arbitration_id);
+
+  const CyclicStatistics &statistics = scheduler.getStatistics(0);
+  assertEqual(3, statistics.sent_frames);
+  assertEqual(1, statistics.missed_deadlines);
+  assertEqual(11000, statistics.last_jitter_us);
+  assertEqual(11000, statistics.max_jitter_us);
+  assertEqual(6000, scheduler.getStatistics(1).last_jitter_us);
+  assertEqual(0, scheduler.getStatistics(1).missed_deadlines);
+
+  // The next releases stay on the original grid
+  assertEqual(9000, scheduler.timeUntilNext(1031000));
+  assertEqual(1, scheduler.tick(1040000));
+  assertEqual(0, scheduler.getStatistics(0).last_jitter_us);
+
+  scheduler.resetStatistics();
+  assertEqual(0, scheduler.getStatistics(0).sent_frames);
+}
+
+unittest(test_cyclic_scheduler_phase)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  CyclicScheduler<2, BasicSerialCAN<LoopbackStream> > scheduler{&serialCAN, 1000};
+  Frame frame_a{0x10, 1};
+  Frame frame_b{0x20, 1};
+  Frame incoming_frame{};
+
+  serialCAN.begin(460800);  // Does nothing here
+
+  // Explicit phases are kept as given, modulo the period
+  assertTrue(scheduler.addWithPhase(&frame_a, 10000, 25000));
+  assertEqual(5000, scheduler.getPhase(0));
+  assertEqual(0, scheduler.tick(100000));
+  assertEqual(5000, scheduler.timeUntilNext(100000));
+  assertEqual(1, scheduler.tick(105000));
+
+  // Frames added while running join the schedule at their next release
+  assertTrue(scheduler.add(&frame_b, 10000));
+  assertEqual(0, scheduler.getPhase(1));
+  assertEqual(5000, scheduler.timeUntilNext(105000));
+  assertEqual(1, scheduler.tick(110000));
+  assertEqual(1, scheduler.tick(115000));
+  assertEqual(0, scheduler.getStatistics(1).missed_deadlines);
+
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x10, incoming_frame.arbitration_id);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x20, incoming_frame.arbitration_id);
+  assertEqual(110, incoming_frame.timestamp);
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(0x10, incoming_frame.arbitration_id);
+}
+
+unittest(test_sequence_tracker)
+{
+  StaticSequenceTracker<2> tracker;
+
+  // The first frame of an ID starts its sequence
+  assertEqual(SequenceTracker::sequence_in_order, tracker.track(0x10, 5));
+  assertEqual(SequenceTracker::sequence_in_order, tracker.track(0x10, 6));
+  assertEqual(SequenceTracker::sequence_lost, tracker.track(0x10, 9));
+  assertEqual(2, tracker.getLastGap());
+  assertEqual(SequenceTracker::sequence_repeated, tracker.track(0x10, 9));
+  assertEqual(SequenceTracker::sequence_out_of_order, tracker.track(0x10, 7));
+  assertEqual(SequenceTracker::sequence_in_order, tracker.track(0x10, 10));
+
+  // Counters wrap around, IDs are tracked separately
+  assertEqual(SequenceTracker::sequence_in_order, tracker.track(0x08, 255));
+  assertEqual(SequenceTracker::sequence_in_order, tracker.track(0x08, 0));
+  assertEqual(SequenceTracker::sequence_lost, tracker.track(0x08, 2));
+  assertEqual(SequenceTracker::sequence_untracked, tracker.track(0x20, 0));
+
+  assertEqual(2, tracker.size());
+  assertEqual(2, tracker.getLostFrames(0x10));
+  assertEqual(1, tracker.getLostFrames(0x08));
+  assertEqual(0, tracker.getLostFrames(0x20));
+
+  const SequenceStatistics &statistics = tracker.getStatistics();
+  assertEqual(5, statistics.in_order_frames);
+  assertEqual(3, statistics.lost_frames);
+  assertEqual(1, statistics.repeated_frames);
+  assertEqual(1, statistics.out_of_order_frames);
+  assertEqual(1, statistics.untracked_frames);
+
+  tracker.reset();
+  assertEqual(0, tracker.size());
+  assertEqual(0, tracker.getStatistics().lost_frames);
+}
+
+unittest(test_serial_can_sequence_tracker)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  StaticSequenceTracker<4> tracker;
+  Frame outgoing_frame{0x123, 4, Frame::crc8};
+  Frame incoming_frame{Frame::crc8};
+
+  serialCAN.begin(460800);  // Does nothing here
+  serialCAN.setSequenceTracker(&tracker);
+
+  serialCAN.send(&outgoing_frame, 0);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::none, serialCAN.getFaultReason());
+
+  // Frames with unexpected counters are still received
+  outgoing_frame.counter = 3;
+  serialCAN.send(&outgoing_frame, 1);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::frames_lost, serialCAN.getFaultReason());
+  assertEqual(3, incoming_frame.counter);
+
+  outgoing_frame.counter = 3;
+  serialCAN.send(&outgoing_frame, 2);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::frame_repeated, serialCAN.getFaultReason());
+
+  outgoing_frame.counter = 1;
+  serialCAN.send(&outgoing_frame, 3);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::frame_out_of_order, serialCAN.getFaultReason());
+
+  outgoing_frame.counter = 4;
+  serialCAN.send(&outgoing_frame, 4);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(SerialCAN::none, serialCAN.getFaultReason());
+  assertEqual(2, tracker.getLostFrames(0x123));
+
+  // Frames without CRC carry no counter and are not tracked
+  Frame plain_frame{0x456, 2};
+  Frame incoming_plain_frame;
+  serialCAN.send(&plain_frame, 5);
+  assertTrue(serialCAN.receive(&incoming_plain_frame, 100));
+  assertEqual(1, tracker.size());
+}
+
+#if SERIALCAN_STATISTICS
+unittest(test_link_statistics)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  Frame outgoing_frame{0x123, 4, Frame::crc8};
+  Frame incoming_frame{Frame::crc8};
+  const uint8_t garbage[] = {0x01, 0x02, 0x03};
+
+  serialCAN.begin(460800);  // Does nothing here
+
+  // Header, 4 byte payload and end byte
+  serialCAN.send(&outgoing_frame, 0);
+  assertEqual(1, serialCAN.getStatistics().frames_sent);
+  assertEqual(15, serialCAN.getStatistics().bytes_sent);
+
+  assertTrue(serialCAN.receive(&incoming_frame, 100));
+  assertEqual(1, serialCAN.getStatistics().frames_received);
+  assertEqual(15, serialCAN.getStatistics().bytes_received);
+
+  // Bytes before the start byte are discarded
+  loopback.write(garbage, sizeof(garbage));
+  serialCAN.send(&outgoing_frame, 1);
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertEqual(3, serialCAN.getStatistics().discarded_bytes);
+  assertEqual(33, serialCAN.getStatistics().bytes_received);
+
+  // Faults are counted by reason
+  serialCAN.send(&outgoing_frame, 2);
+  loopback.buffer[loopback.write_idx - 2] ^= 0xFF;
+  assertEqual(SerialCAN::frame_error, serialCAN.tryReceive(&incoming_frame));
+  while (serialCAN.tryReceive(&incoming_frame) != SerialCAN::need_more_bytes) {}
+  assertFalse(serialCAN.receive(&incoming_frame, 100));
+
+  LinkStatistics statistics = serialCAN.getStatistics();
+  assertEqual(3, statistics.frames_sent);
+  assertEqual(2, statistics.frames_received);
+  assertEqual(1, statistics.faults[SerialCAN::crc_mismatch]);
+  assertEqual(1, statistics.faults[SerialCAN::no_incoming_data]);
+  assertEqual(0, statistics.faults[SerialCAN::timeout]);
+
+#if SERIALCAN_STATISTICS_TIMING
+  // Every received frame is in the parse time histogram
+  uint32_t histogram_frames = 0;
+  for (size_t i = 0; i < serial_can::LINK_PARSE_TIME_BUCKETS; i++) {
+    histogram_frames += statistics.parse_time_histogram[i];
+  }
+  assertEqual(2, histogram_frames);
+  assertEqual(0, serial_can::parseTimeBucket(0));
+  assertEqual(1, serial_can::parseTimeBucket(1));
+  assertEqual(4, serial_can::parseTimeBucket(15));
+  assertEqual(15, serial_can::parseTimeBucket(0xFFFFFFFF));
+#endif
+
+  // The snapshot is not affected by later traffic or a reset
+  Frame batch[2] = {{0x10, 2}, {0x11, 2}};
+  serialCAN.resetStatistics();
+  serialCAN.sendBatch(batch, 2, 3);
+  assertEqual(3, statistics.frames_sent);
+  assertEqual(2, serialCAN.getStatistics().frames_sent);
+  assertEqual(26, serialCAN.getStatistics().bytes_sent);
+  assertEqual(0, serialCAN.getStatistics().frames_received);
+  assertEqual(0, serialCAN.getStatistics().faults[SerialCAN::crc_mismatch]);
+}
+#endif
+
+unittest(test_iso_tp)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream> serialCAN{&loopback};
+  serialCAN.begin(460800);  // Does nothing here
+
+  // Both channels share the loopback stream, the receiver asks for blocks of 4 frames
+  IsoTpChannel<16, BasicSerialCAN<LoopbackStream> > sender{&serialCAN, 0x7E0, 0x7E8};
+  IsoTpChannel<300, BasicSerialCAN<LoopbackStream> > receiver{&serialCAN, 0x7E8, 0x7E0, 4, 0};
+  Frame incoming_frame{};
+  uint8_t message[300];
+  uint32_t now_us = 0;
+
+  for (int i = 0; i < 300; i++) {
+    message[i] = i;
+  }
+
+  // Single frame
+  assertTrue(sender.send(message, 5, now_us));
+  assertFalse(sender.sending());
+  while (serialCAN.tryReceive(&incoming_frame) == SerialCAN::frame_ready) {
+    assertTrue(receiver.onFrame(&incoming_frame, now_us));
+  }
+  assertTrue(receiver.available());
+  assertEqual(5, receiver.length());
+  assertEqual(4, receiver.data()[4]);
+  receiver.release();
+
+  // Segmented transfer in blocks
+  assertTrue(sender.send(message, 300, now_us));
+  assertTrue(sender.sending());
+  assertFalse(sender.send(message, 300, now_us));
+  for (int i = 0; i < 100 && !receiver.available(); i++) {
+    now_us += 100;
+    sender.poll(now_us);
+    receiver.poll(now_us);
+    while (serialCAN.tryReceive(&incoming_frame) == SerialCAN::frame_ready) {
+      sender.onFrame(&incoming_frame, now_us);
+      receiver.onFrame(&incoming_frame, now_us);
+    }
+  }
+  assertFalse(sender.sending());
+  assertTrue(receiver.available());
+  assertEqual(300, receiver.length());
+  assertEqual(0, memcmp(message, receiver.data(), 300));
+  assertEqual(IsoTpBase::none, receiver.getFaultReason());
+
+  // A message that is not released is not overwritten
+  assertTrue(sender.send(message, 3, now_us));
+  while (serialCAN.tryReceive(&incoming_frame) == SerialCAN::frame_ready) {
+    receiver.onFrame(&incoming_frame, now_us);
+  }
+  assertEqual(IsoTpBase::receive_overrun, receiver.getFaultReason());
+  assertEqual(300, receiver.length());
+  receiver.release();
+
+  // The sender gives up without flow control
+  assertTrue(sender.send(message, 20, now_us));
+  now_us += IsoTpBase::timeout_us + 1;
+  sender.poll(now_us);
+  assertFalse(sender.sending());
+  assertEqual(IsoTpBase::tx_timeout, sender.getFaultReason());
+
+  // The receiver gives up without consecutive frames
+  while (serialCAN.tryReceive(&incoming_frame) == SerialCAN::frame_ready) {
+    receiver.onFrame(&incoming_frame, now_us);
+  }
+  now_us += IsoTpBase::timeout_us + 1;
+  receiver.poll(now_us);
+  assertFalse(receiver.available());
+  assertEqual(IsoTpBase::rx_timeout, receiver.getFaultReason());
+
+  // Timers start at the time of send() and onFrame(), even without an earlier poll()
+  IsoTpChannel<16, BasicSerialCAN<LoopbackStream> > late_sender{&serialCAN, 0x7E0, 0x7E8};
+  IsoTpChannel<300, BasicSerialCAN<LoopbackStream> > late_receiver{&serialCAN, 0x7E8, 0x7E0};
+  now_us = 5000000;
+  assertTrue(late_sender.send(message, 100, now_us));
+  assertEqual(0, late_sender.poll(now_us + 100));
+  assertTrue(late_sender.sending());
+  assertEqual(IsoTpBase::none, late_sender.getFaultReason());
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertTrue(late_receiver.onFrame(&incoming_frame, now_us + 200));
+  assertEqual(0, late_receiver.poll(now_us + 300));
+  assertEqual(IsoTpBase::none, late_receiver.getFaultReason());
+
+  // poll() sends one consecutive frame per call unless asked for more
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  assertTrue(late_sender.onFrame(&incoming_frame, now_us + 400));
+  assertEqual(1, late_sender.poll(now_us + 500));
+  assertEqual(3, late_sender.poll(now_us + 600, 3));
+  while (late_sender.sending() || loopback.available() > 0) {
+    late_sender.poll(now_us + 700);
+    while (serialCAN.tryReceive(&incoming_frame) == SerialCAN::frame_ready) {
+      late_receiver.onFrame(&incoming_frame, now_us + 700);
+    }
+  }
+  assertTrue(late_receiver.available());
+  assertEqual(0, memcmp(message, late_receiver.data(), 100));
+
+  // STmin encoding
+  assertEqual(20000, IsoTpBase::stMinToMicros(20));
+  assertEqual(300, IsoTpBase::stMinToMicros(0xF3));
+  assertEqual(127000, IsoTpBase::stMinToMicros(0x80));
+}
+
+unittest(test_iso_tp_fd)
+{
+  LoopbackStream loopback;
+  BasicSerialCAN<LoopbackStream, MAX_FD_DLC> serialCAN{&loopback};
+  serialCAN.begin(460800);  // Does nothing here
+
+  IsoTpChannel<16, BasicSerialCAN<LoopbackStream, MAX_FD_DLC> > sender{
+    &serialCAN, 0x7E0, 0x7E8};
+  IsoTpChannel<100, BasicSerialCAN<LoopbackStream, MAX_FD_DLC> > receiver{
+    &serialCAN, 0x7E8, 0x7E0};
+  FDFrame incoming_frame{};
+  uint8_t message[100];
+  uint32_t now_us = 0;
+
+  for (int i = 0; i < 100; i++) {
+    message[i] = 100 - i;
+  }
+
+  // Single frame with length escape
+  assertTrue(sender.send(message, 40, now_us));
+  assertFalse(sender.sending());
+  assertEqual(SerialCAN::frame_ready, serialCAN.tryReceive(&incoming_frame));
+  receiver.onFrame(&incoming_frame, now_us);
+  assertTrue(receiver.available());
+  assertEqual(40, receiver.length());
+  assertEqual(0, memcmp(message, receiver.data(), 40));
+  receiver.release();
+
+  // First frame, flow control and one consecutive frame
+  assertTrue(sender.send(message, 100, now_us));
+  for (int i = 0; i < 10 && !receiver.available(); i++) {
+    now_us = i;
+    sender.poll(now_us);
+    while (serialCAN.tryReceive(&incoming_frame) == SerialCAN::frame_ready) {
+      sender.onFrame(&incoming_frame, now_us);
+      receiver.onFrame(&incoming_frame, now_us);
+    }
+  }
+  assertTrue(receiver.available());
+  assertEqual(100, receiver.length());
+  assertEqual(0, memcmp(message, receiver.data(), 100));
+}
+
 unittest_main()
 
 